@@ -0,0 +1,186 @@
+#include "bc.h"
+
+#include <vector>
+#include <queue>
+#include <random>
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "breadth_first_search/bfs.h"
+#include "common/graph.h"
+
+#define NOT_VISITED_MARKER -1
+#define CHUNKSIZE 1024
+
+void sample_sources(Graph g, int num_sources, unsigned int seed, Vertex *sources) {
+  // partial Fisher-Yates shuffle of the vertex ids
+  std::vector<Vertex> ids(g->num_nodes);
+  for (int i = 0; i < g->num_nodes; i++)
+    ids[i] = i;
+  std::mt19937 rng(seed);
+  for (int i = 0; i < num_sources; i++) {
+    std::uniform_int_distribution<int> pick(i, g->num_nodes - 1);
+    std::swap(ids[i], ids[pick(rng)]);
+    sources[i] = ids[i];
+  }
+}
+
+// Implements Brandes' algorithm with level-synchronous phases.
+//
+// The forward phase is the top-down BFS: each new frontier is written
+// directly after the previous one in `order`, so levelStarts records
+// every level without copying.  Path counts of a level are pulled from
+// the level above it.  The backward phase walks the same levels from
+// the deepest up, pulling dependencies from the level below, so
+// neither phase needs atomics.
+void betweenness_centrality(Graph g, const Vertex *sources, int num_sources, double *scores) {
+  int numNodes = g->num_nodes;
+  int *distances = (int *)malloc(sizeof(int) * numNodes);
+  double *sigma = (double *)malloc(sizeof(double) * numNodes);
+  double *delta = (double *)malloc(sizeof(double) * numNodes);
+  Vertex *order = (Vertex *)malloc(sizeof(Vertex) * numNodes);
+  std::vector<int> levelStarts;
+
+  #pragma omp parallel for
+  for (int i = 0; i < numNodes; i++)
+    scores[i] = 0.0;
+
+  for (int s = 0; s < num_sources; s++) {
+    Vertex source = sources[s];
+
+    #pragma omp parallel for
+    for (int i = 0; i < numNodes; i++) {
+      distances[i] = NOT_VISITED_MARKER;
+      sigma[i] = 0.0;
+      delta[i] = 0.0;
+    }
+    distances[source] = 0;
+    sigma[source] = 1.0;
+    order[0] = source;
+
+    vertex_set frontier;
+    frontier.vertices = order;
+    frontier.count = 1;
+    frontier.max_vertices = numNodes;
+    levelStarts.clear();
+    levelStarts.push_back(0);
+    levelStarts.push_back(1);
+
+    // forward phase
+    while (true) {
+      int levelEnd = levelStarts.back();
+      vertex_set new_frontier;
+      new_frontier.vertices = order + levelEnd;
+      new_frontier.count = 0;
+      new_frontier.max_vertices = numNodes - levelEnd;
+      top_down_step_void(g, &frontier, &new_frontier, distances);
+      if (new_frontier.count == 0)
+        break;
+
+      #pragma omp parallel for schedule(dynamic, CHUNKSIZE)
+      for (int i = 0; i < new_frontier.count; i++) {
+        Vertex node = new_frontier.vertices[i];
+        int parentDistance = distances[node] - 1;
+        double paths = 0.0;
+        const Vertex *end = incoming_end(g, node);
+        for (const Vertex *u = incoming_begin(g, node); u != end; u++) {
+          if (distances[*u] == parentDistance)
+            paths += sigma[*u];
+        }
+        sigma[node] = paths;
+      }
+
+      levelStarts.push_back(levelEnd + new_frontier.count);
+      frontier = new_frontier;
+    }
+
+    // backward phase; the deepest level has no dependents
+    for (int level = (int)levelStarts.size() - 3; level >= 0; level--) {
+      #pragma omp parallel for schedule(dynamic, CHUNKSIZE)
+      for (int i = levelStarts[level]; i < levelStarts[level + 1]; i++) {
+        Vertex node = order[i];
+        int childDistance = distances[node] + 1;
+        double dependency = 0.0;
+        const Vertex *end = outgoing_end(g, node);
+        for (const Vertex *w = outgoing_begin(g, node); w != end; w++) {
+          if (distances[*w] == childDistance)
+            dependency += (1.0 + delta[*w]) / sigma[*w];
+        }
+        delta[node] = sigma[node] * dependency;
+        if (node != source)
+          scores[node] += delta[node];
+      }
+    }
+  }
+
+  if (num_sources < numNodes) {
+    double scale = (double)numNodes / num_sources;
+    #pragma omp parallel for
+    for (int i = 0; i < numNodes; i++)
+      scores[i] *= scale;
+  }
+
+  free(distances);
+  free(sigma);
+  free(delta);
+  free(order);
+}
+
+void betweenness_centrality_serial(Graph g, const Vertex *sources, int num_sources, double *scores) {
+  int numNodes = g->num_nodes;
+  std::vector<int> distances(numNodes);
+  std::vector<double> sigma(numNodes), delta(numNodes);
+  std::vector<Vertex> stack;
+  stack.reserve(numNodes);
+
+  for (int i = 0; i < numNodes; i++)
+    scores[i] = 0.0;
+
+  for (int s = 0; s < num_sources; s++) {
+    Vertex source = sources[s];
+    for (int i = 0; i < numNodes; i++) {
+      distances[i] = NOT_VISITED_MARKER;
+      sigma[i] = 0.0;
+      delta[i] = 0.0;
+    }
+    distances[source] = 0;
+    sigma[source] = 1.0;
+    stack.clear();
+
+    std::queue<Vertex> queue;
+    queue.push(source);
+    while (!queue.empty()) {
+      Vertex node = queue.front();
+      queue.pop();
+      stack.push_back(node);
+      const Vertex *end = outgoing_end(g, node);
+      for (const Vertex *w = outgoing_begin(g, node); w != end; w++) {
+        if (distances[*w] == NOT_VISITED_MARKER) {
+          distances[*w] = distances[node] + 1;
+          queue.push(*w);
+        }
+        if (distances[*w] == distances[node] + 1)
+          sigma[*w] += sigma[node];
+      }
+    }
+
+    while (!stack.empty()) {
+      Vertex w = stack.back();
+      stack.pop_back();
+      const Vertex *end = incoming_end(g, w);
+      for (const Vertex *v = incoming_begin(g, w); v != end; v++) {
+        if (distances[*v] == distances[w] - 1)
+          delta[*v] += sigma[*v] / sigma[w] * (1.0 + delta[w]);
+      }
+      if (w != source)
+        scores[w] += delta[w];
+    }
+  }
+
+  if (num_sources < numNodes) {
+    double scale = (double)numNodes / num_sources;
+    for (int i = 0; i < numNodes; i++)
+      scores[i] *= scale;
+  }
+}
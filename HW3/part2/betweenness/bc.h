@@ -0,0 +1,17 @@
+#ifndef __BC_H__
+#define __BC_H__
+
+#include "common/graph.h"
+
+// Picks num_sources distinct vertices uniformly at random.
+void sample_sources(Graph graph, int num_sources, unsigned int seed, Vertex* sources);
+
+// Brandes betweenness centrality accumulated over the given sources.
+// When num_sources < num_nodes the result is scaled by
+// num_nodes / num_sources to estimate the exact score.
+void betweenness_centrality(Graph graph, const Vertex* sources, int num_sources, double* scores);
+
+// Serial Brandes, used as the correctness reference.
+void betweenness_centrality_serial(Graph graph, const Vertex* sources, int num_sources, double* scores);
+
+#endif
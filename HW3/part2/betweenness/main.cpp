@@ -0,0 +1,140 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <omp.h>
+#include <string>
+#include <cmath>
+
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#include "common/CycleTimer.h"
+#include "common/graph.h"
+#include "bc.h"
+
+#define DEFAULT_NUM_SOURCES 16
+#define SAMPLE_SEED 15418
+#define RELATIVE_TOLERANCE 1e-9
+
+int main(int argc, char** argv) {
+
+    if (argc < 2)
+    {
+        std::cerr << "Usage: <path/to/graph/file> [num_sources] [num_threads]\n";
+        std::cerr << "  num_sources: sampled roots for approximate scores, 0 for exact (default "
+                  << DEFAULT_NUM_SOURCES << ")\n";
+        exit(1);
+    }
+
+    std::string graph_filename = argv[1];
+
+    int num_sources = DEFAULT_NUM_SOURCES;
+    if (argc >= 3)
+    {
+        num_sources = atoi(argv[2]);
+    }
+
+    int thread_count = -1;
+    if (argc == 4)
+    {
+        thread_count = atoi(argv[3]);
+    }
+
+    printf("----------------------------------------------------------\n");
+    printf("Max system threads = %d\n", omp_get_max_threads());
+    printf("----------------------------------------------------------\n");
+
+    printf("Loading graph...\n");
+    Graph g = load_graph_binary(graph_filename.c_str());
+    printf("\n");
+    printf("Graph stats:\n");
+    printf("  Edges: %d\n", g->num_edges);
+    printf("  Nodes: %d\n", g->num_nodes);
+
+    if (num_sources <= 0 || num_sources > g->num_nodes)
+        num_sources = g->num_nodes;
+    printf("  Sources: %d%s\n", num_sources, num_sources == g->num_nodes ? " (exact)" : " (sampled)");
+
+    std::vector<Vertex> sources(num_sources);
+    if (num_sources == g->num_nodes) {
+        for (int i = 0; i < num_sources; i++)
+            sources[i] = i;
+    } else {
+        sample_sources(g, num_sources, SAMPLE_SEED, sources.data());
+    }
+
+    std::vector<int> num_threads;
+    if (thread_count <= -1)
+    {
+        int max_threads = omp_get_max_threads();
+        for (int i = 1; i < max_threads; i *= 2) {
+          num_threads.push_back(i);
+        }
+        num_threads.push_back(max_threads);
+    }
+    else
+    {
+        num_threads.push_back(std::min(thread_count, omp_get_max_threads()));
+    }
+
+    double* ref_scores = (double*)malloc(sizeof(double) * g->num_nodes);
+    double* scores = (double*)malloc(sizeof(double) * g->num_nodes);
+
+    double start = CycleTimer::currentSeconds();
+    betweenness_centrality_serial(g, sources.data(), num_sources, ref_scores);
+    double serial_time = CycleTimer::currentSeconds() - start;
+
+    double base_time = 0;
+    bool check = true;
+    std::stringstream timing;
+    timing << "Threads  Brandes (Speedup)   vs. Serial\n";
+
+    for (size_t i = 0; i < num_threads.size(); i++)
+    {
+        printf("----------------------------------------------------------\n");
+        std::cout << "Running with " << num_threads[i] << " threads" << std::endl;
+        omp_set_num_threads(num_threads[i]);
+
+        start = CycleTimer::currentSeconds();
+        betweenness_centrality(g, sources.data(), num_sources, scores);
+        double time = CycleTimer::currentSeconds() - start;
+        if (i == 0)
+            base_time = time;
+
+        std::cout << "Testing Correctness of Betweenness Centrality\n";
+        for (int j=0; j<g->num_nodes; j++) {
+            double tolerance = RELATIVE_TOLERANCE * std::max(1.0, fabs(ref_scores[j]));
+            if (fabs(scores[j] - ref_scores[j]) > tolerance) {
+                fprintf(stderr, "*** Results disagree at %d: %g, %g\n", j, scores[j], ref_scores[j]);
+                check = false;
+                break;
+            }
+        }
+
+        char buf[1024];
+        sprintf(buf, "%4d:    %.4f (%.2fx)     %.2fx\n",
+                num_threads[i], time, base_time/time, serial_time/time);
+        timing << buf;
+    }
+
+    Vertex top = 0;
+    for (int j=1; j<g->num_nodes; j++) {
+        if (scores[j] > scores[top])
+            top = j;
+    }
+
+    printf("----------------------------------------------------------\n");
+    printf("Serial Brandes: %.4f sec\n", serial_time);
+    printf("Most central vertex: %d (score %g)\n", top, scores[top]);
+    std::cout << "Timing Summary" << std::endl;
+    std::cout << timing.str();
+    printf("----------------------------------------------------------\n");
+    if (!check)
+        std::cout << "Betweenness Centrality is not Correct" << std::endl;
+
+    free(ref_scores);
+    free(scores);
+    free_graph(g);
+
+    return 0;
+}
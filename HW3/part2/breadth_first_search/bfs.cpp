@@ -1,18 +1,38 @@
 #include "bfs.h"
 
+#include <algorithm>
 #include <utility>
+#include <vector>
 #include <cstddef>
+#include <climits>
 #include <omp.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86_SIMD 1
+#endif
 
 #include "../common/CycleTimer.h"
 #include "../common/graph.h"
+#include "../common/partition.h"
 
 #define ROOT_NODE_ID 0
 #define NOT_VISITED_MARKER -1
 #define CHUNKSIZE 16384
+// Top-down steps split the frontier into this many edge-balanced parts
+// per thread, handed out dynamically.
+#define PARTS_PER_THREAD 4
+// How many frontier vertices / neighbors ahead top-down steps prefetch.
+// Set to 0 to compile the prefetching out; BFS_PREFETCH=off or
+// bfs_prefetch_enable turns it off at run time.
+#define FRONTIER_PREFETCH_DISTANCE 4
+#define NEIGHBOR_PREFETCH_DISTANCE 8
+// Balanced top-down: frontier vertices per task, and the edge-range
+// size that high-degree adjacency lists are split into.
+#define VERTEX_TASK_GRAIN 1024
+#define EDGE_CHUNK 4096
 void vertex_set_clear(vertex_set *list) { list->count = 0; }
 
 void vertex_set_init(vertex_set *list, int count) {
@@ -21,46 +41,213 @@ void vertex_set_init(vertex_set *list, int count) {
   vertex_set_clear(list);
 }
 
+// Per-level trace.  Searches append one record per level to a fixed
+// ring buffer, overwriting the oldest; with tracing off the only cost
+// is a flag test per level.
+static bool trace_enabled = false;
+static bfs_level_trace trace_ring[BFS_TRACE_CAPACITY];
+static long long trace_next = 0;
+static int trace_searches = 0;
+
+void bfs_trace_enable(bool enabled) { trace_enabled = enabled; }
+
+void bfs_trace_clear() {
+  trace_next = 0;
+  trace_searches = 0;
+}
+
+static inline int trace_begin() { return trace_enabled ? trace_searches++ : -1; }
+
+static inline double trace_clock() {
+  return trace_enabled ? CycleTimer::currentSeconds() : 0.0;
+}
+
+static void trace_level(int search, const char *kernel, int level, char direction, int frontier,
+                        long long examined, int newVisited, double start) {
+  if (!trace_enabled)
+    return;
+  bfs_level_trace &t = trace_ring[trace_next++ % BFS_TRACE_CAPACITY];
+  t.search = search;
+  t.kernel = kernel;
+  t.level = level;
+  t.direction = direction;
+  t.frontier = frontier;
+  t.edges_examined = examined;
+  // every newly visited vertex was discovered through exactly one edge
+  t.edges_succeeded = newVisited;
+  t.new_visited = newVisited;
+  t.seconds = CycleTimer::currentSeconds() - start;
+}
+
+void bfs_trace_dump(FILE *out, bool json) {
+  long long first = std::max(0LL, trace_next - BFS_TRACE_CAPACITY);
+  if (json)
+    fprintf(out, "[\n");
+  else
+    fprintf(out, "search,kernel,level,direction,frontier,edges_examined,edges_succeeded,"
+                 "new_visited,seconds\n");
+  for (long long r = first; r < trace_next; r++) {
+    const bfs_level_trace &t = trace_ring[r % BFS_TRACE_CAPACITY];
+    if (json)
+      fprintf(out, "  {\"search\": %d, \"kernel\": \"%s\", \"level\": %d, \"direction\": \"%s\", "
+                   "\"frontier\": %d, \"edges_examined\": %lld, \"edges_succeeded\": %lld, "
+                   "\"new_visited\": %d, \"seconds\": %.9f}%s\n",
+              t.search, t.kernel, t.level, t.direction == 'T' ? "top_down" : "bottom_up",
+              t.frontier, t.edges_examined, t.edges_succeeded, t.new_visited, t.seconds,
+              (r + 1 < trace_next) ? "," : "");
+    else
+      fprintf(out, "%d,%s,%d,%s,%d,%lld,%lld,%d,%.9f\n",
+              t.search, t.kernel, t.level, t.direction == 'T' ? "top_down" : "bottom_up",
+              t.frontier, t.edges_examined, t.edges_succeeded, t.new_visited, t.seconds);
+  }
+  if (json)
+    fprintf(out, "]\n");
+}
+
+// Top-down steps read distances[] (and, for the hybrid heuristic, the
+// degrees) of every neighbor at random.  These helpers issue the
+// loads a few vertices / edges ahead of their use so the misses overlap
+// instead of stalling the expansion one by one.
+static bool default_prefetch() {
+  const char *forced = getenv("BFS_PREFETCH");
+  return !(forced && !strcmp(forced, "off"));
+}
+
+static bool prefetch_enabled = default_prefetch();
+
+void bfs_prefetch_enable(bool enabled) { prefetch_enabled = enabled; }
+
+bool bfs_prefetch_enabled() { return prefetch_enabled; }
+
+static inline void prefetch_frontier(Graph g, vertex_set *frontier, int i) {
+  if (FRONTIER_PREFETCH_DISTANCE > 0 && prefetch_enabled &&
+      i + FRONTIER_PREFETCH_DISTANCE < frontier->count) {
+    int ahead = frontier->vertices[i + FRONTIER_PREFETCH_DISTANCE];
+    __builtin_prefetch(&g->outgoing_starts[ahead]);
+  }
+}
+
+static inline void prefetch_neighbor(Graph g, int *distances, int edge, int end_edge,
+                                     bool degrees) {
+  if (NEIGHBOR_PREFETCH_DISTANCE > 0 && prefetch_enabled &&
+      edge + NEIGHBOR_PREFETCH_DISTANCE < end_edge) {
+    int ahead = g->outgoing_edges[edge + NEIGHBOR_PREFETCH_DISTANCE];
+    __builtin_prefetch(&distances[ahead]);
+    if (degrees) {
+      __builtin_prefetch(&g->outgoing_degrees[ahead]);
+      __builtin_prefetch(&g->incoming_degrees[ahead]);
+    }
+  }
+}
+
+// Expand the edges [start_edge, end_edge) of a frontier vertex: claim
+// every unvisited neighbor and append it to new_frontier.
+static inline void expand_edge_range(Graph g, int node, int start_edge, int end_edge,
+                                     vertex_set *new_frontier, int *distances) {
+  for (int neighbor = start_edge; neighbor < end_edge; neighbor++) {
+    prefetch_neighbor(g, distances, neighbor, end_edge, false);
+    int outgoing = g->outgoing_edges[neighbor];
+    if (distances[outgoing] != NOT_VISITED_MARKER)
+      continue;
+
+    bool success = __sync_bool_compare_and_swap(
+        &distances[outgoing], NOT_VISITED_MARKER, distances[node] + 1);
+    if (!success)
+      continue;
+    // atomic version of index = new_frontier->count++;
+    int index = __sync_fetch_and_add(&new_frontier->count, 1);
+    new_frontier->vertices[index] = outgoing;
+  }
+}
+
+// Split the frontier into parts with equal vertex + edge work, by
+// binary search over the prefix-summed out-degrees.  Returns the
+// number of parts; part p is [boundaries[p], boundaries[p + 1]).
+static int partition_frontier(Graph g, vertex_set *frontier, std::vector<int> &boundaries) {
+  int parts = omp_get_max_threads() * PARTS_PER_THREAD;
+  std::vector<int> prefix(frontier->count + 1);
+  parallel_prefix_sum([&](int i) { return outgoing_degree(g, frontier->vertices[i]); },
+                      frontier->count, prefix.data());
+  boundaries.resize(parts + 1);
+  merge_path_partition([&](int i) { return prefix[i]; }, frontier->count, parts,
+                       boundaries.data());
+  return parts;
+}
+
 // Take one step of "top-down" BFS.  For each vertex on the frontier,
 // follow all outgoing edges, and add all neighboring vertices to the
 // new_frontier.
 void top_down_step_void(Graph g, vertex_set *frontier, vertex_set *new_frontier,
                    int *distances) {
-  int i = 0;
-  #pragma omp parallel for shared(frontier, new_frontier, distances) \
-    private(i) schedule(static, CHUNKSIZE)
-  for (i = 0; i < frontier->count; i++) {
+  std::vector<int> boundaries;
+  int parts = partition_frontier(g, frontier, boundaries);
+  #pragma omp parallel for shared(frontier, new_frontier, distances) schedule(dynamic, 1)
+  for (int part = 0; part < parts; part++) {
+    for (int i = boundaries[part]; i < boundaries[part + 1]; i++) {
+      prefetch_frontier(g, frontier, i);
 
-    int node = frontier->vertices[i];
+      int node = frontier->vertices[i];
 
-    int start_edge = g->outgoing_starts[node];
-    int end_edge = (node == g->num_nodes - 1) ? g->num_edges
-                                              : g->outgoing_starts[node + 1];
+      int start_edge = g->outgoing_starts[node];
+      int end_edge = (node == g->num_nodes - 1) ? g->num_edges
+                                                : g->outgoing_starts[node + 1];
 
-    // attempt to add all neighbors to the new frontier
-    for (int neighbor = start_edge; neighbor < end_edge; neighbor++) {
-      int outgoing = g->outgoing_edges[neighbor];
-      if (distances[outgoing] != NOT_VISITED_MARKER)
-        continue;
-
-      bool success = __sync_bool_compare_and_swap(
-          &distances[outgoing], NOT_VISITED_MARKER, distances[node] + 1);
-      if (!success)
-        continue;
-      // atomic version of index = new_frontier->count++;
-      int index = __sync_fetch_and_add(&new_frontier->count, 1);
-      new_frontier->vertices[index] = outgoing;
+      // attempt to add all neighbors to the new frontier
+      expand_edge_range(g, node, start_edge, end_edge, new_frontier, distances);
     }
   }
 }
 
 std::pair<int,int> top_down_step(Graph g, vertex_set *frontier, vertex_set *new_frontier,
                    int *distances) {
-  int i = 0;
   int newFrontOutSum = 0, newFrontInSum = 0;
+  std::vector<int> boundaries;
+  int parts = partition_frontier(g, frontier, boundaries);
   #pragma omp parallel for shared(frontier, new_frontier, distances) \
-    private(i) reduction(+:newFrontOutSum, newFrontInSum) schedule(static, CHUNKSIZE)
-  for (i = 0; i < frontier->count; i++) {
+    reduction(+:newFrontOutSum, newFrontInSum) schedule(dynamic, 1)
+  for (int part = 0; part < parts; part++) {
+    for (int i = boundaries[part]; i < boundaries[part + 1]; i++) {
+      prefetch_frontier(g, frontier, i);
+
+      int node = frontier->vertices[i];
+
+      int start_edge = g->outgoing_starts[node];
+      int end_edge = (node == g->num_nodes - 1) ? g->num_edges
+                                                : g->outgoing_starts[node + 1];
+
+      // attempt to add all neighbors to the new frontier
+      for (int neighbor = start_edge; neighbor < end_edge; neighbor++) {
+        prefetch_neighbor(g, distances, neighbor, end_edge, true);
+        int outgoing = g->outgoing_edges[neighbor];
+        if (distances[outgoing] != NOT_VISITED_MARKER)
+          continue;
+
+        bool success = __sync_bool_compare_and_swap(
+            &distances[outgoing], NOT_VISITED_MARKER, distances[node] + 1);
+        if (!success)
+          continue;
+        // atomic version of index = new_frontier->count++;
+        int index = __sync_fetch_and_add(&new_frontier->count, 1);
+        new_frontier->vertices[index] = outgoing;
+        newFrontOutSum += outgoing_degree(g, outgoing);
+        newFrontInSum += incoming_degree(g, outgoing);
+      }
+    }
+  }
+  return std::make_pair(newFrontOutSum, newFrontInSum);
+}
+
+// Top-down step that stays balanced under degree skew.  Frontier
+// vertices are handed out as tasks; a vertex with more than EDGE_CHUNK
+// edges has its adjacency split into EDGE_CHUNK-sized edge-range tasks,
+// which idle threads steal, so one hub no longer serializes a level.
+void top_down_step_balanced(Graph g, vertex_set *frontier, vertex_set *new_frontier,
+                            int *distances) {
+  #pragma omp parallel
+  #pragma omp single
+  #pragma omp taskloop grainsize(VERTEX_TASK_GRAIN)
+  for (int i = 0; i < frontier->count; i++) {
+    prefetch_frontier(g, frontier, i);
 
     int node = frontier->vertices[i];
 
@@ -68,35 +255,24 @@ std::pair<int,int> top_down_step(Graph g, vertex_set *frontier, vertex_set *new_
     int end_edge = (node == g->num_nodes - 1) ? g->num_edges
                                               : g->outgoing_starts[node + 1];
 
-    // attempt to add all neighbors to the new frontier
-    for (int neighbor = start_edge; neighbor < end_edge; neighbor++) {
-      int outgoing = g->outgoing_edges[neighbor];
-      if (distances[outgoing] != NOT_VISITED_MARKER)
-        continue;
-
-      bool success = __sync_bool_compare_and_swap(
-          &distances[outgoing], NOT_VISITED_MARKER, distances[node] + 1);
-      if (!success)
-        continue;
-      // atomic version of index = new_frontier->count++;
-      int index = __sync_fetch_and_add(&new_frontier->count, 1);
-      new_frontier->vertices[index] = outgoing;
-      int outSE = g->outgoing_starts[outgoing], outED = (outgoing == g->num_nodes - 1) ? g->num_edges
-                                                                                       : g->outgoing_starts[outgoing + 1];
-      int inSE = g->incoming_starts[outgoing], inED = (outgoing == g->num_nodes - 1) ? g->num_edges
-                                                                                     : g->incoming_starts[outgoing + 1];
-      newFrontOutSum += outED - outSE;
-      newFrontInSum += inED - inSE;
+    if (end_edge - start_edge <= EDGE_CHUNK) {
+      expand_edge_range(g, node, start_edge, end_edge, new_frontier, distances);
+      continue;
+    }
+    for (int chunk = start_edge; chunk < end_edge; chunk += EDGE_CHUNK) {
+      int chunk_end = std::min(chunk + EDGE_CHUNK, end_edge);
+      #pragma omp task firstprivate(node, chunk, chunk_end)
+      expand_edge_range(g, node, chunk, chunk_end, new_frontier, distances);
     }
   }
-  return std::make_pair(newFrontOutSum, newFrontInSum);
 }
 
-// Implements top-down BFS.
-//
-// Result of execution is that, for each node in the graph, the
-// distance to the root is stored in sol.distances.
-void bfs_top_down(Graph graph, solution *sol) {
+typedef void (*top_down_step_fn)(Graph g, vertex_set *frontier, vertex_set *new_frontier,
+                                 int *distances);
+
+// Level-synchronous top-down BFS driven by the given step.
+static void top_down_search(Graph graph, Vertex root, solution *sol, top_down_step_fn step,
+                            const char *kernel) {
 
   vertex_set list1;
   vertex_set list2;
@@ -112,16 +288,30 @@ void bfs_top_down(Graph graph, solution *sol) {
     sol->distances[i] = NOT_VISITED_MARKER;
 
   // setup frontier with the root node
-  frontier->vertices[frontier->count++] = ROOT_NODE_ID;
-  sol->distances[ROOT_NODE_ID] = 0;
+  frontier->vertices[frontier->count++] = root;
+  sol->distances[root] = 0;
+  int search = trace_begin();
+  int level = 0;
   
   while (frontier->count != 0) {
 
 #ifdef VERBOSE
     double start_time = CycleTimer::currentSeconds();
 #endif
+    // the edges examined are the frontier's out-degrees, summed before
+    // the clock starts so the level's time is the step's alone
+    long long examined = 0;
+    if (trace_enabled) {
+      #pragma omp parallel for reduction(+:examined)
+      for (int i = 0; i < frontier->count; i++)
+        examined += outgoing_degree(graph, frontier->vertices[i]);
+    }
+    double start = trace_clock();
     vertex_set_clear(new_frontier);
-    top_down_step_void(graph, frontier, new_frontier, sol->distances);
+    step(graph, frontier, new_frontier, sol->distances);
+    trace_level(search, kernel, level, 'T', frontier->count, examined,
+                new_frontier->count, start);
+    level++;
 
 #ifdef VERBOSE
     double end_time = CycleTimer::currentSeconds();
@@ -133,47 +323,336 @@ void bfs_top_down(Graph graph, solution *sol) {
     frontier = new_frontier;
     new_frontier = tmp;
   }
+
+  free(list1.vertices);
+  free(list2.vertices);
+}
+
+// Implements top-down BFS.
+//
+// Result of execution is that, for each node in the graph, the
+// distance to the root is stored in sol.distances.
+void bfs_top_down(Graph graph, solution *sol) {
+  bfs_top_down_from(graph, ROOT_NODE_ID, sol);
+}
+
+void bfs_top_down_from(Graph graph, Vertex root, solution *sol) {
+  top_down_search(graph, root, sol, top_down_step_void, "top_down");
+}
+
+// Top-down BFS with the degree-balanced step.
+void bfs_top_down_balanced(Graph graph, solution *sol) {
+  top_down_search(graph, ROOT_NODE_ID, sol, top_down_step_balanced, "top_down_balanced");
+}
+
+#define UNCLAIMED_PARENT INT_MAX
+
+// Top-down step that also records BFS tree parents.  Whichever frontier
+// vertex wins the race for a neighbor becomes its parent, so the tree
+// can differ from run to run.
+static void top_down_tree_step(Graph g, vertex_set *frontier, vertex_set *new_frontier,
+                               int *distances, int *parents) {
+  std::vector<int> boundaries;
+  int parts = partition_frontier(g, frontier, boundaries);
+  #pragma omp parallel for schedule(dynamic, 1)
+  for (int part = 0; part < parts; part++) {
+    for (int i = boundaries[part]; i < boundaries[part + 1]; i++) {
+      int node = frontier->vertices[i];
+      const Vertex *end = outgoing_end(g, node);
+      for (const Vertex *v = outgoing_begin(g, node); v != end; v++) {
+        int outgoing = *v;
+        if (distances[outgoing] != NOT_VISITED_MARKER)
+          continue;
+        if (!__sync_bool_compare_and_swap(&distances[outgoing], NOT_VISITED_MARKER,
+                                          distances[node] + 1))
+          continue;
+        parents[outgoing] = node;
+        int index = __sync_fetch_and_add(&new_frontier->count, 1);
+        new_frontier->vertices[index] = outgoing;
+      }
+    }
+  }
 }
 
-int bottomUpOneIteration(Graph graph, int *distance, int currentDistance) 
-{
-  int thisIterationVisitedCount = 0;
-  #pragma omp parallel for \
-    shared(distance) reduction(+:thisIterationVisitedCount) schedule(dynamic, CHUNKSIZE)
+// Deterministic version: every undiscovered neighbor is reserved with an
+// atomic min on its parent id, and distances are only committed in a
+// second pass once the level is done, so each vertex ends up with its
+// lowest-numbered parent on the previous level regardless of timing.
+static void top_down_tree_step_deterministic(Graph g, vertex_set *frontier,
+                                             vertex_set *new_frontier,
+                                             int *distances, int *parents) {
+  std::vector<int> boundaries;
+  int parts = partition_frontier(g, frontier, boundaries);
+  #pragma omp parallel for schedule(dynamic, 1)
+  for (int part = 0; part < parts; part++) {
+    for (int i = boundaries[part]; i < boundaries[part + 1]; i++) {
+      int node = frontier->vertices[i];
+      const Vertex *end = outgoing_end(g, node);
+      for (const Vertex *v = outgoing_begin(g, node); v != end; v++) {
+        int outgoing = *v;
+        if (distances[outgoing] != NOT_VISITED_MARKER)
+          continue;
+        // atomic min; the first reservation also queues the vertex
+        int old = parents[outgoing];
+        while (node < old) {
+          if (__sync_bool_compare_and_swap(&parents[outgoing], old, node)) {
+            if (old == UNCLAIMED_PARENT) {
+              int index = __sync_fetch_and_add(&new_frontier->count, 1);
+              new_frontier->vertices[index] = outgoing;
+            }
+            break;
+          }
+          old = parents[outgoing];
+        }
+      }
+    }
+  }
+
+  // commit
+  int level = distances[frontier->vertices[0]] + 1;
+  #pragma omp parallel for schedule(static)
+  for (int i = 0; i < new_frontier->count; i++)
+    distances[new_frontier->vertices[i]] = level;
+}
+
+// Top-down BFS that also builds the BFS tree: parents[v] is v's parent,
+// the root is its own parent and unreached vertices get -1.
+static void bfs_tree_search(Graph graph, Vertex root, solution *sol, int *parents,
+                            bool deterministic) {
+  vertex_set list1;
+  vertex_set list2;
+  vertex_set_init(&list1, graph->num_nodes);
+  vertex_set_init(&list2, graph->num_nodes);
+
+  vertex_set *frontier = &list1;
+  vertex_set *new_frontier = &list2;
+
+  #pragma omp parallel for
   for (int i = 0; i < graph->num_nodes; i++) {
-    if(distance[i] != NOT_VISITED_MARKER) {
-      continue;
+    sol->distances[i] = NOT_VISITED_MARKER;
+    parents[i] = UNCLAIMED_PARENT;
+  }
+
+  frontier->vertices[frontier->count++] = root;
+  sol->distances[root] = 0;
+  parents[root] = root;
+
+  while (frontier->count != 0) {
+    vertex_set_clear(new_frontier);
+    if (deterministic)
+      top_down_tree_step_deterministic(graph, frontier, new_frontier, sol->distances, parents);
+    else
+      top_down_tree_step(graph, frontier, new_frontier, sol->distances, parents);
+    std::swap(frontier, new_frontier);
+  }
+
+  #pragma omp parallel for
+  for (int i = 0; i < graph->num_nodes; i++) {
+    if (parents[i] == UNCLAIMED_PARENT)
+      parents[i] = NOT_VISITED_MARKER;
+  }
+
+  free(list1.vertices);
+  free(list2.vertices);
+}
+
+void bfs_tree_top_down(Graph graph, Vertex root, solution *sol, int *parents) {
+  bfs_tree_search(graph, root, sol, parents, false);
+}
+
+void bfs_tree_top_down_deterministic(Graph graph, Vertex root, solution *sol, int *parents) {
+  bfs_tree_search(graph, root, sol, parents, true);
+}
+
+// Collect every vertex that has not been visited yet.
+void unvisited_set_init(Graph graph, int *distance, unvisited_set *unvisited) {
+  unvisited->num_blocks = (graph->num_nodes + CHUNKSIZE - 1) / CHUNKSIZE;
+  unvisited->block_counts = (int *)malloc(sizeof(int) * unvisited->num_blocks);
+  unvisited->vertices = (int *)malloc(sizeof(int) * graph->num_nodes);
+  int count = 0;
+  #pragma omp parallel for schedule(static) reduction(+:count)
+  for (int b = 0; b < unvisited->num_blocks; b++) {
+    int begin = b * CHUNKSIZE;
+    int end = std::min(begin + CHUNKSIZE, graph->num_nodes);
+    int kept = begin;
+    for (int i = begin; i < end; i++) {
+      if (distance[i] == NOT_VISITED_MARKER)
+        unvisited->vertices[kept++] = i;
     }
-    int start_edge = graph->incoming_starts[i];
-    int end_edge = (i == graph->num_nodes - 1) ? graph->num_edges
-                                          : graph->incoming_starts[i + 1];
-    for (int edge = start_edge; edge < end_edge; edge++) {
-      int incomingNeighbor = graph->incoming_edges[edge];
-      if (distance[incomingNeighbor] == currentDistance) {
-        distance[i] = currentDistance + 1;
-        thisIterationVisitedCount++;
-        break;
+    unvisited->block_counts[b] = kept - begin;
+    count += kept - begin;
+  }
+  unvisited->count = count;
+}
+
+void unvisited_set_free(unvisited_set *unvisited) {
+  free(unvisited->block_counts);
+  free(unvisited->vertices);
+}
+
+// Neighbor probes for bottom-up BFS: return the index of the first of
+// the `count` vertices in `neighbors` that has distance `target`, or -1
+// if there is none.  The vector versions gather 8 or 16 distances at a
+// time and stop at the first group with a hit, so all versions return
+// the same index and produce the same distances.
+typedef int (*probe_fn)(const int *neighbors, int count, const int *distance, int target);
+
+static int probe_scalar(const int *neighbors, int count, const int *distance, int target) {
+  for (int i = 0; i < count; i++) {
+    if (distance[neighbors[i]] == target)
+      return i;
+  }
+  return -1;
+}
+
+// Finish a probe on the tail after `done` neighbors
+static inline int probe_tail(const int *neighbors, int count, const int *distance, int target,
+                             int done) {
+  int hit = probe_scalar(neighbors + done, count - done, distance, target);
+  return (hit < 0) ? -1 : done + hit;
+}
+
+#ifdef HAVE_X86_SIMD
+__attribute__((target("avx2")))
+static int probe_avx2(const int *neighbors, int count, const int *distance, int target) {
+  const __m256i wanted = _mm256_set1_epi32(target);
+  int i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256i index = _mm256_loadu_si256((const __m256i *)(neighbors + i));
+    __m256i gathered = _mm256_i32gather_epi32(distance, index, 4);
+    int mask = _mm256_movemask_epi8(_mm256_cmpeq_epi32(gathered, wanted));
+    if (mask)
+      return i + __builtin_ctz(mask) / 4;
+  }
+  return probe_tail(neighbors, count, distance, target, i);
+}
+
+__attribute__((target("avx512f")))
+static int probe_avx512(const int *neighbors, int count, const int *distance, int target) {
+  const __m512i wanted = _mm512_set1_epi32(target);
+  int i = 0;
+  for (; i + 16 <= count; i += 16) {
+    __m512i index = _mm512_loadu_si512((const void *)(neighbors + i));
+    __m512i gathered = _mm512_i32gather_epi32(index, distance, 4);
+    __mmask16 mask = _mm512_cmpeq_epi32_mask(gathered, wanted);
+    if (mask)
+      return i + __builtin_ctz(mask);
+  }
+  int hit = probe_avx2(neighbors + i, count - i, distance, target);
+  return (hit < 0) ? -1 : i + hit;
+}
+#endif
+
+// Pick the widest probe the CPU supports.  BFS_PROBE=scalar|avx2|avx512
+// in the environment overrides the choice, e.g. to compare them.
+static probe_fn select_probe() {
+  const char *forced = getenv("BFS_PROBE");
+  if (forced && !strcmp(forced, "scalar"))
+    return probe_scalar;
+#ifdef HAVE_X86_SIMD
+  __builtin_cpu_init();
+  bool avx512 = __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx2");
+  bool avx2 = __builtin_cpu_supports("avx2");
+  if (forced && !strcmp(forced, "avx2"))
+    avx512 = false;
+  if (avx512)
+    return probe_avx512;
+  if (avx2)
+    return probe_avx2;
+#endif
+  return probe_scalar;
+}
+
+static const probe_fn probe_neighbors = select_probe();
+
+// Take one step of "bottom-up" BFS over the unvisited vertices only.
+// A vertex joins the next level if any incoming neighbor is on the
+// current one; the rest are compacted in place within their block, so
+// each level costs time proportional to what is left unvisited.  The
+// number of incoming edges looked at is added to *edgesExamined, and
+// if visited is given the newly visited vertices are appended to it.
+int bottomUpOneIteration(Graph graph, unvisited_set *unvisited, int *distance, int currentDistance,
+                         long long *edgesExamined, vertex_set *visited)
+{
+  int thisIterationVisitedCount = 0;
+  long long examined = 0;
+  #pragma omp parallel shared(distance) reduction(+:thisIterationVisitedCount, examined)
+  {
+    int local[CHUNKSIZE / 16];
+    int localCount = 0;
+    #pragma omp for schedule(dynamic, 1) nowait
+    for (int b = 0; b < unvisited->num_blocks; b++) {
+      int *vertices = unvisited->vertices + b * CHUNKSIZE;
+      int count = unvisited->block_counts[b];
+      int kept = 0;
+      for (int idx = 0; idx < count; idx++) {
+        int i = vertices[idx];
+        int start_edge = graph->incoming_starts[i];
+        int end_edge = (i == graph->num_nodes - 1) ? graph->num_edges
+                                              : graph->incoming_starts[i + 1];
+        int degree = end_edge - start_edge;
+        int hit = probe_neighbors(graph->incoming_edges + start_edge, degree,
+                                  distance, currentDistance);
+        if (hit >= 0) {
+          distance[i] = currentDistance + 1;
+          examined += hit + 1;
+          if (visited) {
+            local[localCount++] = i;
+            if (localCount == CHUNKSIZE / 16) {
+              int index = __sync_fetch_and_add(&visited->count, localCount);
+              memcpy(visited->vertices + index, local, sizeof(int) * localCount);
+              localCount = 0;
+            }
+          }
+        } else {
+          vertices[kept++] = i;
+          examined += degree;
+        }
       }
+      unvisited->block_counts[b] = kept;
+      thisIterationVisitedCount += count - kept;
+    }
+    if (visited) {
+      int index = __sync_fetch_and_add(&visited->count, localCount);
+      memcpy(visited->vertices + index, local, sizeof(int) * localCount);
     }
   }
+  unvisited->count -= thisIterationVisitedCount;
+  *edgesExamined += examined;
   return thisIterationVisitedCount;
 }
 
 void bfs_bottom_up(Graph graph, solution *sol) {
+  bfs_bottom_up_from(graph, ROOT_NODE_ID, sol);
+}
+
+void bfs_bottom_up_from(Graph graph, Vertex root, solution *sol) {
   for (int i = 0; i < graph->num_nodes; i++) {
     sol->distances[i] = NOT_VISITED_MARKER;
   }
-  sol->distances[ROOT_NODE_ID] = 0;
-  int visitedCount = 1;
+  sol->distances[root] = 0;
+
+  unvisited_set unvisited;
+  unvisited_set_init(graph, sol->distances, &unvisited);
+
+  int search = trace_begin();
   int currentDistance = 0;
-  while (visitedCount < graph->num_nodes) {
-    int thisIterationVisitedCount = bottomUpOneIteration(graph, sol->distances, currentDistance);
+  int levelCount = 1;
+  while (unvisited.count > 0) {
+    double start = trace_clock();
+    long long examined = 0;
+    int thisIterationVisitedCount = bottomUpOneIteration(graph, &unvisited, sol->distances,
+                                                         currentDistance, &examined, NULL);
+    trace_level(search, "bottom_up", currentDistance, 'B', levelCount, examined,
+                thisIterationVisitedCount, start);
+    levelCount = thisIterationVisitedCount;
     currentDistance++;
-    visitedCount += thisIterationVisitedCount;
     if (thisIterationVisitedCount == 0) {
       break;
     }
   }
+
+  unvisited_set_free(&unvisited);
   // For PP students:
   //
   // You will need to implement the "bottom up" BFS here as
@@ -187,15 +666,52 @@ void bfs_bottom_up(Graph graph, solution *sol) {
   // each step of the BFS process.
 }
 
+// Thresholds used by bfs_hybrid and bfs_hybrid_from
+static hybrid_params hybridParams = {HYBRID_DEFAULT_ALPHA, HYBRID_DEFAULT_BETA};
+
+void bfs_hybrid_set_params(hybrid_params params) { hybridParams = params; }
+
+hybrid_params bfs_hybrid_get_params() { return hybridParams; }
+
+// What the hybrid heuristic needs when it turns top-down again: the
+// out-degree sum of the frontier, which the bottom-up step collected,
+// and the in-degree sum of the vertices still unvisited.
+static int frontier_out_degrees(Graph graph, vertex_set *frontier) {
+  int outDegSum = 0;
+  #pragma omp parallel for reduction(+:outDegSum)
+  for (int i = 0; i < frontier->count; i++)
+    outDegSum += outgoing_degree(graph, frontier->vertices[i]);
+  return outDegSum;
+}
+
+static int unvisited_in_degrees(Graph graph, unvisited_set *unvisited) {
+  int inDegSum = 0;
+  #pragma omp parallel for schedule(static) reduction(+:inDegSum)
+  for (int b = 0; b < unvisited->num_blocks; b++) {
+    const int *vertices = unvisited->vertices + b * CHUNKSIZE;
+    for (int idx = 0; idx < unvisited->block_counts[b]; idx++)
+      inDegSum += incoming_degree(graph, vertices[idx]);
+  }
+  return inDegSum;
+}
+
 void bfs_hybrid(Graph graph, solution *sol) {
+  bfs_hybrid_from(graph, ROOT_NODE_ID, sol);
+}
+
+void bfs_hybrid_from(Graph graph, Vertex root, solution *sol) {
+  bfs_hybrid_with(graph, root, sol, hybridParams);
+}
+
+void bfs_hybrid_with(Graph graph, Vertex root, solution *sol, hybrid_params params) {
   // meta data for hybrid
   bool isTopDown = true;
   int outDegSumOfFrontier = 0;
   int inDegSumOfUnvisited = 0;
   int numOfUnvisited = graph->num_nodes;
   
-  // heuristic parameters provided by the handout
-  int alpha = 14, beta = 24;
+  // heuristic parameters; the handout's are alpha = 14, beta = 24
+  int alpha = params.alpha, beta = params.beta;
 
   vertex_set list1;
   vertex_set list2;
@@ -204,6 +720,8 @@ void bfs_hybrid(Graph graph, solution *sol) {
 
   vertex_set *frontier = &list1;
   vertex_set *new_frontier = &list2;
+  // built when the search turns bottom-up, freed when it turns back
+  unvisited_set unvisited;
 
 
   // initialize all nodes to NOT_VISITED
@@ -211,46 +729,75 @@ void bfs_hybrid(Graph graph, solution *sol) {
     sol->distances[i] = NOT_VISITED_MARKER;
 
   // setup frontier with the root node
-  frontier->vertices[frontier->count++] = ROOT_NODE_ID;
-  sol->distances[ROOT_NODE_ID] = 0;
+  frontier->vertices[frontier->count++] = root;
+  sol->distances[root] = 0;
  
   if (graph->num_nodes == 1) {
+    free(list1.vertices);
+    free(list2.vertices);
     return;
   }
   
-  outDegSumOfFrontier = graph->outgoing_starts[1];
-  inDegSumOfUnvisited = graph->num_edges - graph->incoming_starts[1];
-  int numOfFrontier = 0;
+  outDegSumOfFrontier = outgoing_degree(graph, root);
+  inDegSumOfUnvisited = graph->num_edges - incoming_degree(graph, root);
   numOfUnvisited -= 1; 
 
   int currentDistance = 0;
+  int search = trace_begin();
+  int levelCount = 1;
   
   while (numOfUnvisited > 0) {
+    double start = trace_clock();
     if (isTopDown) {
+      // the frontier's out-degree sum is exactly the edges this step examines
+      long long examined = outDegSumOfFrontier;
       vertex_set_clear(new_frontier);
       auto [out, in] = top_down_step(graph, frontier, new_frontier, sol->distances);
       outDegSumOfFrontier = out;
       inDegSumOfUnvisited -= in;
       numOfUnvisited -= new_frontier->count;
+      trace_level(search, "hybrid", currentDistance, 'T', frontier->count, examined,
+                  new_frontier->count, start);
+      levelCount = new_frontier->count;
       if (new_frontier->count == 0)break;
       // printf("top %d\n", new_frontier->count);
       std::swap(frontier, new_frontier);
     }
     else {
-      int frontierCount = bottomUpOneIteration(graph, sol->distances, currentDistance); 
+      // the level visited here becomes the frontier if the search turns top-down
+      long long examined = 0;
+      vertex_set_clear(frontier);
+      int frontierCount = bottomUpOneIteration(graph, &unvisited, sol->distances, currentDistance,
+                                               &examined, frontier);
       numOfUnvisited -= frontierCount;
+      trace_level(search, "hybrid", currentDistance, 'B', levelCount, examined,
+                  frontierCount, start);
       // printf("bot %d\n", frontierCount);
       if (frontierCount == 0)break;
+      // a small, shrinking frontier is cheaper to expand top-down again
+      if (frontierCount < levelCount && frontierCount < graph->num_nodes / beta) {
+        isTopDown = true;
+        inDegSumOfUnvisited = unvisited_in_degrees(graph, &unvisited);
+        unvisited_set_free(&unvisited);
+        outDegSumOfFrontier = frontier_out_degrees(graph, frontier);
+      }
+      levelCount = frontierCount;
     }
     currentDistance++;
 
     if (isTopDown) {
       if (outDegSumOfFrontier > (inDegSumOfUnvisited / alpha) ) {
         isTopDown = false;
+        unvisited_set_init(graph, sol->distances, &unvisited);
       }
     }
   }
 
+  if (!isTopDown)
+    unvisited_set_free(&unvisited);
+  free(list1.vertices);
+  free(list2.vertices);
+
   // For PP students:
   //
   // You will need to implement the "hybrid" BFS here as
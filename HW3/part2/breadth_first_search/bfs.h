@@ -3,6 +3,8 @@
 
 //#define DEBUG
 
+#include <stdio.h>
+
 #include "common/graph.h"
 
 struct solution
@@ -19,9 +21,102 @@ struct vertex_set {
   int *vertices;
 };
 
+// Vertices not yet visited, bucketed by id into fixed-size blocks.
+// Block b keeps its unvisited ids compacted at the front of its slice
+// of vertices and block_counts[b] says how many remain, so the set
+// shrinks in place as bottom-up BFS proceeds.
+struct unvisited_set {
+  // # of vertices in the set
+  int count;
+  int num_blocks;
+  int *block_counts;
+  int *vertices;
+};
+
+void vertex_set_init(vertex_set* list, int count);
+void vertex_set_clear(vertex_set* list);
+
+// One level of top-down BFS: appends the newly discovered neighbors of
+// frontier to new_frontier and sets their distances.
+void top_down_step_void(Graph g, vertex_set* frontier, vertex_set* new_frontier,
+                        int* distances);
 
 void bfs_top_down(Graph graph, solution* sol);
 void bfs_bottom_up(Graph graph, solution* sol);
 void bfs_hybrid(Graph graph, solution* sol);
 
+// The above search from vertex 0; these take the root explicitly
+void bfs_top_down_from(Graph graph, Vertex root, solution* sol);
+void bfs_bottom_up_from(Graph graph, Vertex root, solution* sol);
+void bfs_hybrid_from(Graph graph, Vertex root, solution* sol);
+
+// Direction switching thresholds for hybrid BFS: switch to bottom-up
+// once the frontier's out-edges exceed 1/alpha of the unvisited
+// vertices' in-edges, and back to top-down once a shrinking frontier
+// holds fewer than num_nodes / beta vertices.
+struct hybrid_params {
+  int alpha;
+  int beta;
+};
+
+#define HYBRID_DEFAULT_ALPHA 14
+#define HYBRID_DEFAULT_BETA 24
+
+// bfs_hybrid and bfs_hybrid_from use the thresholds set here
+// (default HYBRID_DEFAULT_ALPHA / HYBRID_DEFAULT_BETA)
+void bfs_hybrid_set_params(hybrid_params params);
+hybrid_params bfs_hybrid_get_params();
+void bfs_hybrid_with(Graph graph, Vertex root, solution* sol, hybrid_params params);
+
+// Autotuner (hybrid_tune.cpp): time hybrid BFS from num_roots sampled
+// roots over a grid of thresholds and return the fastest setting for
+// the current thread count.
+hybrid_params bfs_hybrid_autotune(Graph graph, int num_roots, unsigned int seed);
+// Tuned thresholds are cached in a small text file beside the graph,
+// one line per thread count, tagged with the graph's size; loading
+// fails if there is no line for this size and thread count.
+bool load_hybrid_params(const char* filename, Graph graph, int threads, hybrid_params* params);
+bool store_hybrid_params(const char* filename, Graph graph, int threads, hybrid_params params);
+
+// Software prefetching in the top-down steps, on unless BFS_PREFETCH=off
+// is in the environment
+void bfs_prefetch_enable(bool enabled);
+bool bfs_prefetch_enabled();
+
+// Alternative BFS implementations, timed by main.cpp beside the above
+void bfs_top_down_balanced(Graph graph, solution* sol);
+
+// Top-down BFS from root that also returns the BFS tree: parents[v] is
+// the parent of v, the root is its own parent and unreached vertices
+// get -1.  The
+// deterministic version always picks the lowest-numbered parent.
+void bfs_tree_top_down(Graph graph, Vertex root, solution* sol, int* parents);
+void bfs_tree_top_down_deterministic(Graph graph, Vertex root, solution* sol, int* parents);
+
+// Per-level BFS trace.  When enabled, bfs_top_down, bfs_bottom_up and
+// bfs_hybrid (and their *_from versions) record one entry per level in
+// a ring buffer of the last BFS_TRACE_CAPACITY levels.
+struct bfs_level_trace {
+  // which search (counted from the last clear) and which kernel ran it
+  int search;
+  const char *kernel;
+  int level;
+  // 'T' top-down or 'B' bottom-up
+  char direction;
+  // vertices on the level being expanded
+  int frontier;
+  long long edges_examined;
+  // edges that discovered a new vertex
+  long long edges_succeeded;
+  int new_visited;
+  double seconds;
+};
+
+#define BFS_TRACE_CAPACITY 4096
+
+void bfs_trace_enable(bool enabled);
+void bfs_trace_clear();
+// Write the buffered levels, oldest first, as CSV or as a JSON array
+void bfs_trace_dump(FILE* out, bool json);
+
 #endif
@@ -0,0 +1,137 @@
+#include "bfs.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../common/CycleTimer.h"
+#include "../common/graph.h"
+
+// Candidate thresholds.  Small alpha keeps the search top-down longer
+// (high-diameter, low-degree graphs); large alpha turns it bottom-up
+// early (low-diameter, skewed graphs).  Large beta stays bottom-up
+// through the tail of the search.
+static const int tune_alphas[] = {1, 2, 4, 8, 14, 24, 64};
+static const int tune_betas[] = {4, 8, 24, 64, 256};
+// Each root is searched this many times per setting; the fastest counts
+#define TUNE_REPEATS 2
+
+// Total time of the hybrid from every root, or early out with a value
+// above `limit` once the setting is known to lose.
+static double time_setting(Graph graph, const std::vector<Vertex> &roots, solution *sol,
+                           hybrid_params params, double limit) {
+  double total = 0;
+  for (Vertex root : roots) {
+    double fastest = 0;
+    for (int r = 0; r < TUNE_REPEATS; r++) {
+      double start = CycleTimer::currentSeconds();
+      bfs_hybrid_with(graph, root, sol, params);
+      double time = CycleTimer::currentSeconds() - start;
+      if (r == 0 || time < fastest)
+        fastest = time;
+      if (limit > 0 && total + fastest > limit)
+        return total + fastest;
+    }
+    total += fastest;
+  }
+#ifdef VERBOSE
+  printf("alpha=%-4d beta=%-4d %.6f sec\n", params.alpha, params.beta, total);
+#endif
+  return total;
+}
+
+// Coordinate search: alpha with the default beta, then beta with the
+// best alpha.  The two thresholds act on different phases of the
+// search (ramp-up and tail), so this finds nearly the same setting as
+// the full grid at a fraction of the cost.
+hybrid_params bfs_hybrid_autotune(Graph graph, int num_roots, unsigned int seed) {
+  // roots are random vertices with at least one edge
+  std::vector<Vertex> roots;
+  for (int v = 0; v < graph->num_nodes; v++) {
+    if (outgoing_degree(graph, v) > 0)
+      roots.push_back(v);
+  }
+  hybrid_params best = {HYBRID_DEFAULT_ALPHA, HYBRID_DEFAULT_BETA};
+  if (roots.empty())
+    return best;
+  std::shuffle(roots.begin(), roots.end(), std::mt19937(seed));
+  roots.resize(std::min(num_roots, (int)roots.size()));
+
+  solution sol;
+  sol.distances = (int *)malloc(sizeof(int) * graph->num_nodes);
+
+  // warm up the caches and the thread pool
+  bfs_hybrid_with(graph, roots[0], &sol, best);
+
+  double bestTime = time_setting(graph, roots, &sol, best, 0);
+  for (int alpha : tune_alphas) {
+    hybrid_params params = {alpha, best.beta};
+    double total = time_setting(graph, roots, &sol, params, bestTime);
+    if (total < bestTime) {
+      bestTime = total;
+      best = params;
+    }
+  }
+  for (int beta : tune_betas) {
+    hybrid_params params = {best.alpha, beta};
+    double total = time_setting(graph, roots, &sol, params, bestTime);
+    if (total < bestTime) {
+      bestTime = total;
+      best = params;
+    }
+  }
+
+  free(sol.distances);
+  return best;
+}
+
+// One line per thread count tuned for the graph:
+// "nodes N edges M threads T alpha A beta B"
+struct cached_params {
+  int nodes, edges, threads;
+  hybrid_params params;
+};
+
+static std::vector<cached_params> read_hybrid_cache(const char *filename) {
+  std::vector<cached_params> lines;
+  FILE *file = fopen(filename, "r");
+  if (!file)
+    return lines;
+  cached_params line;
+  while (fscanf(file, " nodes %d edges %d threads %d alpha %d beta %d", &line.nodes,
+                &line.edges, &line.threads, &line.params.alpha, &line.params.beta) == 5)
+    lines.push_back(line);
+  fclose(file);
+  return lines;
+}
+
+bool load_hybrid_params(const char *filename, Graph graph, int threads, hybrid_params *params) {
+  for (const cached_params &line : read_hybrid_cache(filename)) {
+    if (line.nodes == graph->num_nodes && line.edges == graph->num_edges &&
+        line.threads == threads && line.params.alpha > 0 && line.params.beta > 0) {
+      *params = line.params;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool store_hybrid_params(const char *filename, Graph graph, int threads, hybrid_params params) {
+  // keep the other thread counts tuned for this graph
+  std::vector<cached_params> lines;
+  for (const cached_params &line : read_hybrid_cache(filename)) {
+    if (line.nodes == graph->num_nodes && line.edges == graph->num_edges &&
+        line.threads != threads)
+      lines.push_back(line);
+  }
+  lines.push_back({graph->num_nodes, graph->num_edges, threads, params});
+  FILE *file = fopen(filename, "w");
+  if (!file)
+    return false;
+  for (const cached_params &line : lines)
+    fprintf(file, "nodes %d edges %d threads %d alpha %d beta %d\n", line.nodes, line.edges,
+            line.threads, line.params.alpha, line.params.beta);
+  return fclose(file) == 0;
+}
@@ -13,21 +13,172 @@
 #include "bfs.h"
 
 #define USE_BINARY_GRAPH 1
+#define BFS_TRACE_FILE "bfs_trace"
+#define HYBRID_CACHE_SUFFIX ".hybrid"
+#define TUNE_ROOTS 4
+#define TUNE_SEED 15418
 
 void reference_bfs_bottom_up(Graph graph, solution* sol);
 void reference_bfs_top_down(Graph graph, solution* sol);
 void reference_bfs_hybrid(Graph graph, solution* sol);
 
+// Alternative implementations, checked against our own top-down result.
+// Tree variants also fill parents; lowest_parent variants must pick
+// the lowest-numbered parent on the previous level.
+struct bfs_variant {
+    const char* name;
+    void (*run)(Graph graph, solution* sol, int* parents);
+    bool tree;
+    bool lowest_parent;
+};
+
+// Top-down BFS with its prefetching off, against Top Down with it on
+static void top_down_no_prefetch(Graph g, solution* sol, int*)
+{
+    bool enabled = bfs_prefetch_enabled();
+    bfs_prefetch_enable(false);
+    bfs_top_down(g, sol);
+    bfs_prefetch_enable(enabled);
+}
+
+static const bfs_variant variants[] = {
+    {"Top Down (no prefetch)", top_down_no_prefetch, false, false},
+    {"Top Down (balanced)",
+     [](Graph g, solution* sol, int*) { bfs_top_down_balanced(g, sol); }, false, false},
+    {"BFS Tree",
+     [](Graph g, solution* sol, int* parents) { bfs_tree_top_down(g, 0, sol, parents); },
+     true, false},
+    {"BFS Tree (deterministic)",
+     [](Graph g, solution* sol, int* parents) { bfs_tree_top_down_deterministic(g, 0, sol, parents); },
+     true, true},
+};
+static const int num_variants = sizeof(variants) / sizeof(variants[0]);
+
+// Every reached non-root vertex needs an in-neighbor one level up as
+// parent, and with lowest_parent no lower such in-neighbor may exist.
+static bool check_tree(Graph g, const solution& sol, const int* parents, bool lowest_parent)
+{
+    for (int v=0; v<g->num_nodes; v++) {
+        int d = sol.distances[v];
+        if (d <= 0) {
+            if (parents[v] != (d == 0 ? v : -1)) {
+                fprintf(stderr, "*** Bad parent for %d: %d\n", v, parents[v]);
+                return false;
+            }
+            continue;
+        }
+        int best = -1;
+        bool found = false;
+        for (const Vertex* u = incoming_begin(g, v); u != incoming_end(g, v); u++) {
+            if (sol.distances[*u] != d - 1)
+                continue;
+            if (*u == parents[v])
+                found = true;
+            if (best == -1 || *u < best)
+                best = *u;
+        }
+        if (!found || (lowest_parent && parents[v] != best)) {
+            fprintf(stderr, "*** Bad parent for %d: %d (lowest valid %d)\n", v, parents[v], best);
+            return false;
+        }
+    }
+    return true;
+}
+
+static void run_variants(Graph g, int threads, const solution& top_down, double top_time,
+                         std::stringstream& timing, std::vector<bool>& checks)
+{
+    solution sol;
+    sol.distances = (int*)malloc(sizeof(int) * g->num_nodes);
+    int* parents = (int*)malloc(sizeof(int) * g->num_nodes);
+    for (int v = 0; v < num_variants; v++) {
+        double start = CycleTimer::currentSeconds();
+        variants[v].run(g, &sol, parents);
+        double time = CycleTimer::currentSeconds() - start;
+
+        std::cout << "Testing Correctness of " << variants[v].name << "\n";
+        for (int j=0; j<g->num_nodes; j++) {
+            if (sol.distances[j] != top_down.distances[j]) {
+                fprintf(stderr, "*** Results disagree at %d: %d, %d\n", j, sol.distances[j], top_down.distances[j]);
+                checks[v] = false;
+                break;
+            }
+        }
+        if (checks[v] && variants[v].tree && !check_tree(g, sol, parents, variants[v].lowest_parent))
+            checks[v] = false;
+
+        char buf[1024];
+        sprintf(buf, "%4d:    %-24s %.4f (%.2fx)\n",
+                threads, variants[v].name, time, top_time/time);
+        timing << buf;
+    }
+    free(parents);
+    free(sol.distances);
+}
+
+static void print_variants(std::stringstream& timing, std::vector<bool>& checks)
+{
+    std::cout << "Variants: Timing Summary (speedup vs. Top Down)" << std::endl;
+    std::cout << timing.str();
+    for (int v = 0; v < num_variants; v++) {
+        if (!checks[v])
+            std::cout << variants[v].name << " is not Correct" << std::endl;
+    }
+    printf("----------------------------------------------------------\n");
+}
+
+// Thresholds for our hybrid at the current thread count, from the cache
+// or tuned and added to it.  The tuning runs are left out of the trace.
+static void use_tuned_params(Graph g, const std::string& cache_filename, bool trace)
+{
+    int threads = omp_get_max_threads();
+    hybrid_params params;
+    if (load_hybrid_params(cache_filename.c_str(), g, threads, &params)) {
+        printf("Hybrid thresholds from %s\n", cache_filename.c_str());
+    } else {
+        bfs_trace_enable(false);
+        double start = CycleTimer::currentSeconds();
+        params = bfs_hybrid_autotune(g, TUNE_ROOTS, TUNE_SEED);
+        printf("Hybrid thresholds tuned in %.2f sec\n", CycleTimer::currentSeconds() - start);
+        bfs_trace_enable(trace);
+        if (!store_hybrid_params(cache_filename.c_str(), g, threads, params))
+            fprintf(stderr, "*** Could not write %s\n", cache_filename.c_str());
+    }
+    printf("Hybrid alpha: %d, beta: %d\n", params.alpha, params.beta);
+    bfs_hybrid_set_params(params);
+}
+
 int main(int argc, char** argv) {
 
     int  num_threads = -1;
     std::string graph_filename;
 
+    // --trace=csv|json and --tune may appear anywhere; strip them before
+    // the positional args
+    std::string trace_format;
+    bool tune = false;
+    int kept = 1;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.compare(0, 8, "--trace=") == 0)
+            trace_format = arg.substr(8);
+        else if (arg == "--tune")
+            tune = true;
+        else
+            argv[kept++] = argv[i];
+    }
+    argc = kept;
+    if (!trace_format.empty() && trace_format != "csv" && trace_format != "json")
+        argc = 0;
+
     if (argc < 2)
     {
-        std::cerr << "Usage: <path/to/graph/file> [num_threads]\n";
+        std::cerr << "Usage: <path/to/graph/file> [num_threads] [--trace=csv|json] [--tune]\n";
         std::cerr << "  To run results for all thread counts: <path/to/graph/file>\n";
         std::cerr << "  Run with a certain number of threads (no correctness run): <path/to/graph/file> <num_threads>\n";
+        std::cerr << "  --trace writes per-level statistics of our BFS runs to " << BFS_TRACE_FILE << ".csv|json\n";
+        std::cerr << "  --tune runs our hybrid with thresholds tuned for the graph and thread count, cached in <graph>"
+                  << HYBRID_CACHE_SUFFIX << "\n";
         exit(1);
     }
 
@@ -65,6 +216,9 @@ int main(int argc, char** argv) {
     printf("  Edges: %d\n", g->num_edges);
     printf("  Nodes: %d\n", g->num_nodes);
 
+    std::string cache_filename = graph_filename + HYBRID_CACHE_SUFFIX;
+    bfs_trace_enable(!trace_format.empty());
+
     //If we want to run on all threads
     if (thread_count <= -1)
     {
@@ -104,6 +258,9 @@ int main(int argc, char** argv) {
         std::stringstream relative_timing;
 
         bool tds_check = true, bus_check = true, hs_check = true;
+        std::stringstream variant_timing;
+        std::vector<bool> variant_checks(num_variants, true);
+        variant_timing << "Threads    Variant                  Time (Speedup)\n";
 
         timing          << "Threads  Top Down          Bottom Up         Hybrid\n";
         ref_timing      << "Threads  Top Down          Bottom Up         Hybrid\n";
@@ -116,6 +273,8 @@ int main(int argc, char** argv) {
             std::cout << "Running with " << num_threads[i] << " threads" << std::endl;
             //Set thread count
             omp_set_num_threads(num_threads[i]);
+            if (tune)
+                use_tuned_params(g, cache_filename, !trace_format.empty());
 
             //Run implementations
             start = CycleTimer::currentSeconds();
@@ -173,6 +332,8 @@ int main(int argc, char** argv) {
                 }
             }
 
+            run_variants(g, num_threads[i], sol1, top_time, variant_timing, variant_checks);
+
             if (i == 0)
             {
                 hybrid_base = hybrid_time;
@@ -209,6 +370,7 @@ int main(int argc, char** argv) {
         std::cout << "Reference: Timing Summary" << std::endl;
         std::cout << ref_timing.str();
         printf("----------------------------------------------------------\n");
+        print_variants(variant_timing, variant_checks);
         std::cout << "Correctness: " << std::endl;
         if (!tds_check)
             std::cout << "Top Down Search is not Correct" << std::endl;
@@ -239,6 +401,9 @@ int main(int argc, char** argv) {
         double start;
         std::stringstream timing;
         std::stringstream ref_timing;
+        std::stringstream variant_timing;
+        std::vector<bool> variant_checks(num_variants, true);
+        variant_timing << "Threads    Variant                  Time (Speedup)\n";
 
 
         timing << "Threads   Top Down    Bottom Up       Hybrid\n";
@@ -248,6 +413,8 @@ int main(int argc, char** argv) {
         std::cout << "Running with " << thread_count << " threads" << std::endl;
         //Set thread count
         omp_set_num_threads(thread_count);
+        if (tune)
+            use_tuned_params(g, cache_filename, !trace_format.empty());
 
         //Run implementations
         start = CycleTimer::currentSeconds();
@@ -307,6 +474,7 @@ int main(int argc, char** argv) {
             }
         }
 
+        run_variants(g, thread_count, sol1, top_time, variant_timing, variant_checks);
 
         char buf[1024];
         char ref_buf[1024];
@@ -331,6 +499,19 @@ int main(int argc, char** argv) {
         std::cout << "Reference: Timing Summary" << std::endl;
         std::cout << ref_timing.str();
         printf("----------------------------------------------------------\n");
+        print_variants(variant_timing, variant_checks);
+    }
+
+    if (!trace_format.empty()) {
+        std::string trace_filename = std::string(BFS_TRACE_FILE) + "." + trace_format;
+        FILE* trace = fopen(trace_filename.c_str(), "w");
+        if (trace) {
+            bfs_trace_dump(trace, trace_format == "json");
+            fclose(trace);
+            printf("Wrote per-level trace to %s\n", trace_filename.c_str());
+        } else {
+            fprintf(stderr, "*** Could not write %s\n", trace_filename.c_str());
+        }
     }
 
     free_graph(g);
@@ -8,6 +8,7 @@
 #include "graph_internal.h"
 
 #define GRAPH_HEADER_TOKEN ((int) 0xDEADBEEF)
+#define WEIGHTED_GRAPH_HEADER_TOKEN ((int) 0xDEADBEEE)
 
 
 void free_graph(Graph graph)
@@ -17,6 +18,12 @@ void free_graph(Graph graph)
 
   free(graph->incoming_starts);
   free(graph->incoming_edges);
+
+  free(graph->outgoing_weights);
+
+  free(graph->outgoing_degrees);
+  free(graph->incoming_degrees);
+  free(graph->dangling_vertices);
   free(graph);
 }
 
@@ -41,6 +48,31 @@ void build_edges(graph* graph, int* scratch)
   }
 }
 
+// Edge weights must not be negative: the shortest-path code relies on it
+static void check_weights(graph* graph)
+{
+  for(int i = 0; i < graph->num_edges; i++)
+  {
+    if (graph->outgoing_weights[i] < 0) {
+      fprintf(stderr, "Negative weight %d on edge %d.\n", graph->outgoing_weights[i], i);
+      exit(1);
+    }
+  }
+}
+
+// Weights follow the edge targets in the scratch buffer of a
+// WeightedAdjacencyGraph file
+void build_weights(graph* graph, int* scratch)
+{
+  int num_nodes = graph->num_nodes;
+  graph->outgoing_weights = (Weight*)malloc(sizeof(Weight) * graph->num_edges);
+  for(int i = 0; i < graph->num_edges; i++)
+  {
+    graph->outgoing_weights[i] = scratch[num_nodes + graph->num_edges + i];
+  }
+  check_weights(graph);
+}
+
 // Given an outgoing edge adjacency list representation for a directed
 // graph, build an incoming adjacency list representation
 void build_incoming_edges(graph* graph) {
@@ -128,14 +160,52 @@ void build_incoming_edges(graph* graph) {
     free(node_scatter);
 }
 
-void get_meta_data(std::ifstream& file, graph* graph)
+static uint16_t* alloc_degrees(int num_nodes)
+{
+  // round up to whole cache lines for aligned_alloc
+  size_t bytes = sizeof(uint16_t) * num_nodes;
+  bytes = (bytes + 63) / 64 * 64;
+  return (uint16_t*)aligned_alloc(64, bytes > 0 ? bytes : 64);
+}
+
+// Build the compact degree arrays from the starts arrays, and the list
+// of dangling vertices.  Degrees that do not fit in 16 bits are marked
+// with DEGREE_ESCAPE.
+void build_degrees(graph* graph)
+{
+  int num_nodes = graph->num_nodes;
+  graph->outgoing_degrees = alloc_degrees(num_nodes);
+  graph->incoming_degrees = alloc_degrees(num_nodes);
+  int num_dangling = 0;
+  for (int i=0; i<num_nodes; i++) {
+    int out = outgoing_size(graph, i);
+    int in = incoming_size(graph, i);
+    graph->outgoing_degrees[i] = (out < DEGREE_ESCAPE) ? out : DEGREE_ESCAPE;
+    graph->incoming_degrees[i] = (in < DEGREE_ESCAPE) ? in : DEGREE_ESCAPE;
+    if (out == 0)
+      num_dangling++;
+  }
+
+  graph->num_dangling = num_dangling;
+  graph->dangling_vertices = (Vertex*)malloc(sizeof(Vertex) * (num_dangling > 0 ? num_dangling : 1));
+  num_dangling = 0;
+  for (int i=0; i<num_nodes; i++) {
+    if (graph->outgoing_degrees[i] == 0)
+      graph->dangling_vertices[num_dangling++] = i;
+  }
+}
+
+// Returns true if the file holds a WeightedAdjacencyGraph, in which
+// case num_edges weights follow the edge list
+bool get_meta_data(std::ifstream& file, graph* graph)
 {
   // going back to the beginning of the file
   file.clear();
   file.seekg(0, std::ios::beg);
   std::string buffer;
   std::getline(file, buffer);
-  if ((buffer.compare(std::string("AdjacencyGraph"))))
+  bool weighted = !buffer.compare(std::string("WeightedAdjacencyGraph"));
+  if (!weighted && (buffer.compare(std::string("AdjacencyGraph"))))
   {
     std::cout << "Invalid input file" << buffer << std::endl;
     exit(1);
@@ -155,6 +225,7 @@ void get_meta_data(std::ifstream& file, graph* graph)
 
   graph->num_edges = atoi(buffer.c_str());
 
+  return weighted;
 }
 
 void read_graph_file(std::ifstream& file, int* scratch)
@@ -219,22 +290,41 @@ Graph load_graph(const char* filename)
   // open the file
   std::ifstream graph_file;
   graph_file.open(filename);
-  get_meta_data(graph_file, graph);
+  bool weighted = get_meta_data(graph_file, graph);
 
-  int* scratch = (int*) malloc(sizeof(int) * (graph->num_nodes + graph->num_edges));
+  int scratch_size = graph->num_nodes + graph->num_edges * (weighted ? 2 : 1);
+  int* scratch = (int*) malloc(sizeof(int) * scratch_size);
   read_graph_file(graph_file, scratch);
 
   build_start(graph, scratch);
   build_edges(graph, scratch);
+  graph->outgoing_weights = NULL;
+  if (weighted)
+    build_weights(graph, scratch);
   free(scratch);
 
   build_incoming_edges(graph);
+  build_degrees(graph);
 
   //print_graph(graph);
 
   return graph;
 }
 
+Graph graph_from_csr(int num_nodes, int num_edges, int* outgoing_starts, Vertex* outgoing_edges)
+{
+  graph* graph = (struct graph*)(malloc(sizeof(struct graph)));
+  graph->num_nodes = num_nodes;
+  graph->num_edges = num_edges;
+  graph->outgoing_starts = outgoing_starts;
+  graph->outgoing_edges = outgoing_edges;
+  graph->outgoing_weights = NULL;
+
+  build_incoming_edges(graph);
+  build_degrees(graph);
+  return graph;
+}
+
 Graph load_graph_binary(const char* filename)
 {
     graph* graph = (struct graph*)(malloc(sizeof(struct graph)));
@@ -253,7 +343,8 @@ Graph load_graph_binary(const char* filename)
         exit(1);
     }
 
-    if (header[0] != GRAPH_HEADER_TOKEN) {
+    bool weighted = header[0] == WEIGHTED_GRAPH_HEADER_TOKEN;
+    if (header[0] != GRAPH_HEADER_TOKEN && !weighted) {
         fprintf(stderr, "Invalid graph file header. File may be corrupt.\n");
         exit(1);
     }
@@ -274,9 +365,20 @@ Graph load_graph_binary(const char* filename)
         exit(1);
     }
 
+    graph->outgoing_weights = NULL;
+    if (weighted) {
+        graph->outgoing_weights = (Weight*)malloc(sizeof(Weight) * graph->num_edges);
+        if (fread(graph->outgoing_weights, sizeof(Weight), graph->num_edges, input) != (size_t) graph->num_edges) {
+            fprintf(stderr, "Error reading weights.\n");
+            exit(1);
+        }
+        check_weights(graph);
+    }
+
     fclose(input);
 
     build_incoming_edges(graph);
+    build_degrees(graph);
     //print_graph(graph);
     return graph;
 }
@@ -291,7 +393,7 @@ void store_graph_binary(const char* filename, Graph graph) {
     }
 
     int header[3];
-    header[0] = GRAPH_HEADER_TOKEN;
+    header[0] = is_weighted(graph) ? WEIGHTED_GRAPH_HEADER_TOKEN : GRAPH_HEADER_TOKEN;
     header[1] = graph->num_nodes;
     header[2] = graph->num_edges;
 
@@ -310,5 +412,11 @@ void store_graph_binary(const char* filename, Graph graph) {
         exit(1);
     }
 
+    if (is_weighted(graph) &&
+        fwrite(graph->outgoing_weights, sizeof(Weight), graph->num_edges, output) != (size_t) graph->num_edges) {
+        fprintf(stderr, "Error writing weights.\n");
+        exit(1);
+    }
+
     fclose(output);
 }
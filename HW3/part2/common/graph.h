@@ -1,7 +1,10 @@
 #ifndef __GRAPH_H__
 #define __GRAPH_H__
 
+#include <stdint.h>
+
 using Vertex = int;
+using Weight = int;
 
 struct graph
 {
@@ -18,8 +21,27 @@ struct graph
 
     int* incoming_starts;
     Vertex* incoming_edges;
+
+    // Optional edge weights, parallel to outgoing_edges: the weight
+    // of edge outgoing_edges[j] is outgoing_weights[j].  NULL for
+    // unweighted graphs.  Never negative; loading rejects such files.
+    Weight* outgoing_weights;
+
+    // Compact per-vertex degrees, built when the graph is loaded so
+    // hot loops don't touch the starts arrays.  A vertex whose degree
+    // doesn't fit is stored as DEGREE_ESCAPE and looked up from the
+    // starts array instead; see outgoing_degree().
+    uint16_t* outgoing_degrees;
+    uint16_t* incoming_degrees;
+
+    // Vertices without outgoing edges in increasing order, also built
+    // at load time.  PageRank spreads their score over all vertices.
+    int num_dangling;
+    Vertex* dangling_vertices;
 };
 
+#define DEGREE_ESCAPE UINT16_MAX
+
 using Graph = graph*;
 
 /* Getters */
@@ -29,19 +51,30 @@ static inline int num_edges(const Graph);
 static inline const Vertex* outgoing_begin(const Graph, Vertex);
 static inline const Vertex* outgoing_end(const Graph, Vertex);
 static inline int outgoing_size(const Graph, Vertex);
+static inline bool is_weighted(const Graph);
+static inline const Weight* outgoing_weights_begin(const Graph, Vertex);
 
 static inline const Vertex* incoming_begin(const Graph, Vertex);
 static inline const Vertex* incoming_end(const Graph, Vertex);
 static inline int incoming_size(const Graph, Vertex);
 
+static inline int outgoing_degree(const Graph, Vertex);
+static inline int incoming_degree(const Graph, Vertex);
+
 
 /* IO */
 Graph load_graph(const char* filename);
 Graph load_graph_binary(const char* filename);
 void store_graph_binary(const char* filename, Graph);
 
+// Wrap an in-memory outgoing CSR (malloc'd arrays, ownership passes to
+// the graph) and build the incoming edges and degrees, as the loaders do.
+Graph graph_from_csr(int num_nodes, int num_edges, int* outgoing_starts, Vertex* outgoing_edges);
+
 void print_graph(const graph*);
 
+void build_degrees(graph*);
+
 
 /* Deallocation */
 void free_graph(Graph);
@@ -42,6 +42,20 @@ static inline int outgoing_size(const Graph g, Vertex v)
   }
 }
 
+static inline bool is_weighted(const Graph g)
+{
+  REQUIRES(g != NULL);
+  return g->outgoing_weights != NULL;
+}
+
+static inline const Weight* outgoing_weights_begin(const Graph g, Vertex v)
+{
+  REQUIRES(g != NULL);
+  REQUIRES(is_weighted(g));
+  REQUIRES(0 <= v && v < num_nodes(g));
+  return g->outgoing_weights + g->outgoing_starts[v];
+}
+
 static inline const Vertex* incoming_begin(const Graph g, Vertex v)
 {
   REQUIRES(g != NULL);
@@ -68,4 +82,22 @@ static inline int incoming_size(const Graph g, Vertex v)
   }
 }
 
+// Same as outgoing_size() / incoming_size(), but served from the
+// compact degree arrays
+static inline int outgoing_degree(const Graph g, Vertex v)
+{
+  REQUIRES(g != NULL);
+  REQUIRES(0 <= v && v < num_nodes(g));
+  int degree = g->outgoing_degrees[v];
+  return (degree != DEGREE_ESCAPE) ? degree : outgoing_size(g, v);
+}
+
+static inline int incoming_degree(const Graph g, Vertex v)
+{
+  REQUIRES(g != NULL);
+  REQUIRES(0 <= v && v < num_nodes(g));
+  int degree = g->incoming_degrees[v];
+  return (degree != DEGREE_ESCAPE) ? degree : incoming_size(g, v);
+}
+
 #endif // __GRAPH_INTERNAL_H__
@@ -0,0 +1,89 @@
+#ifndef __PARTITION_H__
+#define __PARTITION_H__
+
+#include <omp.h>
+#include <vector>
+
+/*
+ * Edge-balanced work partitioning.
+ *
+ * A loop over vertices whose cost is their degree is split so that
+ * every part gets the same number of vertices + edges.  Viewing the
+ * work as a merge of the vertex list with the edge list (merge path),
+ * item i ends at diagonal prefix[i+1] + (i+1), where prefix[i] is the
+ * number of edges of items [0, i).  Each part boundary is then found
+ * by a binary search along that diagonal.
+ */
+
+// Smallest i in [0, count] with prefix(i) + i >= diagonal.  prefix must
+// be non-decreasing.
+template <class Prefix>
+static inline int merge_path_search(const Prefix& prefix, int count, long long diagonal)
+{
+  int lo = 0, hi = count;
+  while (lo < hi) {
+    int mid = lo + (hi - lo) / 2;
+    if ((long long)prefix(mid) + mid < diagonal)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+// Split items [0, count) into num_parts contiguous ranges of equal
+// vertex + edge work.  Part p covers [boundaries[p], boundaries[p+1]),
+// so boundaries must hold num_parts + 1 entries.  prefix(i) is the
+// edge count of items [0, i), for i in [0, count].
+template <class Prefix>
+static inline void merge_path_partition(const Prefix& prefix, int count, int num_parts,
+                                        int* boundaries)
+{
+  long long total = (long long)prefix(count) + count;
+  boundaries[0] = 0;
+  for (int p = 1; p < num_parts; p++)
+    boundaries[p] = merge_path_search(prefix, count, total * p / num_parts);
+  boundaries[num_parts] = count;
+}
+
+// Partition the vertices [0, num_nodes) by the edges in a CSR starts
+// array (outgoing_starts or incoming_starts).
+static inline void partition_vertices(const int* starts, int num_nodes, int num_edges,
+                                      int num_parts, int* boundaries)
+{
+  auto prefix = [=](int i) { return (i == num_nodes) ? num_edges : starts[i]; };
+  merge_path_partition(prefix, num_nodes, num_parts, boundaries);
+}
+
+// Exclusive prefix sum of item(0) .. item(count - 1): out[i] is the
+// sum of items [0, i) and out[count] the total, so out must hold
+// count + 1 entries.  Must be called outside a parallel region.
+template <class Value, class Item>
+static inline void parallel_prefix_sum(const Item& item, int count, Value* out)
+{
+  std::vector<Value> partial(omp_get_max_threads() + 1, 0);
+  #pragma omp parallel num_threads(partial.size() - 1)
+  {
+    int tid = omp_get_thread_num();
+    int threads = omp_get_num_threads();
+    int begin = (long long)count * tid / threads;
+    int end = (long long)count * (tid + 1) / threads;
+    Value sum = 0;
+    for (int i = begin; i < end; i++)
+      sum += item(i);
+    partial[tid + 1] = sum;
+    #pragma omp barrier
+    #pragma omp single
+    for (int t = 0; t < threads; t++)
+      partial[t + 1] += partial[t];
+    Value running = partial[tid];
+    for (int i = begin; i < end; i++) {
+      out[i] = running;
+      running += item(i);
+    }
+    if (tid == threads - 1)
+      out[count] = running;
+  }
+}
+
+#endif /* __PARTITION_H__ */
@@ -0,0 +1,85 @@
+#include "kronecker.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+#include <omp.h>
+#include <stdlib.h>
+
+#define KRONECKER_A 0.57
+#define KRONECKER_B 0.19
+#define KRONECKER_C 0.19
+
+// Counter-based generator so every edge is reproducible no matter which
+// thread draws it
+static inline uint64_t splitmix64(uint64_t x) {
+  x += 0x9E3779B97F4A7C15ULL;
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+  return x ^ (x >> 31);
+}
+
+static inline double uniform(uint64_t &state) {
+  state = splitmix64(state);
+  return (state >> 11) * (1.0 / 9007199254740992.0);
+}
+
+Graph generate_kronecker(int scale, int edgefactor, uint64_t seed) {
+  int numNodes = 1 << scale;
+  long long numGenerated = (long long)edgefactor << scale;
+
+  // random relabeling so vertex ids carry no locality
+  std::vector<Vertex> label(numNodes);
+  for (int i = 0; i < numNodes; i++)
+    label[i] = i;
+  std::shuffle(label.begin(), label.end(), std::mt19937_64(seed));
+
+  // both directions of every edge, packed as (src << 32 | dst) so that
+  // sorting groups them by source
+  std::vector<uint64_t> edges(2 * numGenerated);
+  #pragma omp parallel for schedule(static)
+  for (long long e = 0; e < numGenerated; e++) {
+    uint64_t state = seed ^ splitmix64(e);
+    int u = 0, v = 0;
+    for (int bit = 0; bit < scale; bit++) {
+      double r = uniform(state);
+      if (r < KRONECKER_A) {
+      } else if (r < KRONECKER_A + KRONECKER_B) {
+        v |= 1 << bit;
+      } else if (r < KRONECKER_A + KRONECKER_B + KRONECKER_C) {
+        u |= 1 << bit;
+      } else {
+        u |= 1 << bit;
+        v |= 1 << bit;
+      }
+    }
+    u = label[u];
+    v = label[v];
+    if (u == v) {
+      // self loop, sorted to the end and dropped below
+      edges[2 * e] = edges[2 * e + 1] = UINT64_MAX;
+      continue;
+    }
+    edges[2 * e] = ((uint64_t)u << 32) | (uint32_t)v;
+    edges[2 * e + 1] = ((uint64_t)v << 32) | (uint32_t)u;
+  }
+
+  std::sort(edges.begin(), edges.end());
+  edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+  if (!edges.empty() && edges.back() == UINT64_MAX)
+    edges.pop_back();
+
+  int numEdges = edges.size();
+  int *starts = (int *)malloc(sizeof(int) * numNodes);
+  Vertex *targets = (Vertex *)malloc(sizeof(Vertex) * numEdges);
+  int e = 0;
+  for (int node = 0; node < numNodes; node++) {
+    starts[node] = e;
+    while (e < numEdges && (int)(edges[e] >> 32) == node) {
+      targets[e] = (Vertex)(edges[e] & 0xFFFFFFFFu);
+      e++;
+    }
+  }
+
+  return graph_from_csr(numNodes, numEdges, starts, targets);
+}
@@ -0,0 +1,14 @@
+#ifndef __KRONECKER_H__
+#define __KRONECKER_H__
+
+#include <stdint.h>
+
+#include "common/graph.h"
+
+// Graph500 Kronecker generator: 2^scale vertices and edgefactor * 2^scale
+// generated edges with initiator probabilities A=0.57, B=C=0.19.  Vertex
+// labels are randomly permuted, self loops and duplicates are dropped,
+// and every edge is stored in both directions.
+Graph generate_kronecker(int scale, int edgefactor, uint64_t seed);
+
+#endif
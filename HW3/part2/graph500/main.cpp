@@ -0,0 +1,255 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <omp.h>
+#include <string>
+#include <getopt.h>
+#include <cmath>
+#include <climits>
+
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <vector>
+
+#include "common/CycleTimer.h"
+#include "common/graph.h"
+#include "breadth_first_search/bfs.h"
+#include "kronecker.h"
+
+#define DEFAULT_SCALE 16
+#define DEFAULT_EDGEFACTOR 16
+#define DEFAULT_NUM_ROOTS 64
+#define DEFAULT_SEED 15418
+
+// The kernels under test.  The BFS tree kernel also returns parents,
+// which are validated with the Graph500 tree rules.
+struct kernel {
+    const char* name;
+    void (*run)(Graph graph, Vertex root, solution* sol, int* parents);
+    bool tree;
+};
+
+static const kernel kernels[] = {
+    {"top_down",
+     [](Graph g, Vertex root, solution* sol, int*) { bfs_top_down_from(g, root, sol); }, false},
+    {"bottom_up",
+     [](Graph g, Vertex root, solution* sol, int*) { bfs_bottom_up_from(g, root, sol); }, false},
+    {"hybrid",
+     [](Graph g, Vertex root, solution* sol, int*) { bfs_hybrid_from(g, root, sol); }, false},
+    {"tree",
+     bfs_tree_top_down_deterministic, true},
+};
+static const int num_kernels = sizeof(kernels) / sizeof(kernels[0]);
+
+// Graph500 validation, stated on BFS levels:
+//   1. the root is at level 0 (and is its own parent);
+//   2. every edge u->v from a reached u reaches v, with
+//      level(v) <= level(u) + 1;
+//   3. every other reached vertex v has an in-neighbor at level(v) - 1,
+//      which must be its parent when parents are given.
+// Together these mean the levels are exact BFS distances and the tree
+// spans exactly the vertices reachable from the root.
+static bool validate(Graph g, Vertex root, const int* levels, const int* parents)
+{
+    if (levels[root] != 0 || (parents && parents[root] != root)) {
+        fprintf(stderr, "*** Root %d has level %d\n", root, levels[root]);
+        return false;
+    }
+    int errors = 0;
+    #pragma omp parallel for schedule(dynamic, 1024) reduction(+:errors)
+    for (int v = 0; v < g->num_nodes; v++) {
+        int level = levels[v];
+        if (level < 0) {
+            if (parents && parents[v] != -1)
+                errors++;
+            continue;
+        }
+        for (const Vertex* w = outgoing_begin(g, v); w != outgoing_end(g, v); w++) {
+            if (levels[*w] < 0 || levels[*w] > level + 1)
+                errors++;
+        }
+        if (v == root)
+            continue;
+        bool has_parent = false;
+        for (const Vertex* u = incoming_begin(g, v); u != incoming_end(g, v); u++) {
+            if (levels[*u] == level - 1 && (!parents || parents[v] == *u))
+                has_parent = true;
+        }
+        if (!has_parent)
+            errors++;
+    }
+    if (errors)
+        fprintf(stderr, "*** Validation failed from root %d: %d violations\n", root, errors);
+    return errors == 0;
+}
+
+// Edges inside the traversed component
+static double traversed_edges(Graph g, const int* levels, bool symmetric)
+{
+    long long edges = 0;
+    #pragma omp parallel for reduction(+:edges)
+    for (int v = 0; v < g->num_nodes; v++) {
+        if (levels[v] >= 0)
+            edges += outgoing_degree(g, v);
+    }
+    return symmetric ? edges / 2.0 : (double)edges;
+}
+
+// Graph500-style statistics; quartiles interpolate between samples
+static double quartile(const std::vector<double>& sorted, double q)
+{
+    double pos = q * (sorted.size() - 1);
+    size_t lo = (size_t)pos;
+    size_t hi = std::min(lo + 1, sorted.size() - 1);
+    return sorted[lo] + (pos - lo) * (sorted[hi] - sorted[lo]);
+}
+
+// Prints the statistics and returns the harmonic mean.  Sorts teps.
+static double print_stats(const char* name, std::vector<double>& teps, double mean_time)
+{
+    std::sort(teps.begin(), teps.end());
+    double n = teps.size();
+    double inverse_sum = 0;
+    for (double t : teps)
+        inverse_sum += 1.0 / t;
+    double hmean = n / inverse_sum;
+    double deviation = 0;
+    for (double t : teps)
+        deviation += (1.0 / t - 1.0 / hmean) * (1.0 / t - 1.0 / hmean);
+    double hstddev = (n > 1) ? sqrt(deviation) / (n - 1) * hmean * hmean : 0.0;
+
+    printf("--- %s ---\n", name);
+    printf("min_TEPS:             %.6g\n", teps.front());
+    printf("firstquartile_TEPS:   %.6g\n", quartile(teps, 0.25));
+    printf("median_TEPS:          %.6g\n", quartile(teps, 0.5));
+    printf("thirdquartile_TEPS:   %.6g\n", quartile(teps, 0.75));
+    printf("max_TEPS:             %.6g\n", teps.back());
+    printf("harmonic_mean_TEPS:   %.6g\n", hmean);
+    printf("harmonic_stddev_TEPS: %.6g\n", hstddev);
+    printf("mean_time:            %.6f\n", mean_time);
+    return hmean;
+}
+
+static void usage(const char* binary)
+{
+    std::cerr << "Usage: " << binary << " [-s scale] [-e edgefactor] [-f graph] [-u] [-n roots] [-t threads] [-r seed]\n";
+    std::cerr << "  -s, -e: generate a Kronecker graph (default scale " << DEFAULT_SCALE
+              << ", edgefactor " << DEFAULT_EDGEFACTOR << ")\n";
+    std::cerr << "  -f: load a binary graph instead; -u if it stores undirected edges both ways\n";
+    std::cerr << "  -n: number of random BFS roots (default " << DEFAULT_NUM_ROOTS << ")\n";
+}
+
+int main(int argc, char** argv) {
+
+    int scale = DEFAULT_SCALE;
+    int edgefactor = DEFAULT_EDGEFACTOR;
+    int num_roots = DEFAULT_NUM_ROOTS;
+    int thread_count = -1;
+    unsigned int seed = DEFAULT_SEED;
+    bool symmetric = true;
+    std::string graph_filename;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "s:e:f:un:t:r:h")) != -1) {
+        switch (opt) {
+        case 's': scale = atoi(optarg); break;
+        case 'e': edgefactor = atoi(optarg); break;
+        case 'f': graph_filename = optarg; symmetric = false; break;
+        case 'u': symmetric = true; break;
+        case 'n': num_roots = atoi(optarg); break;
+        case 't': thread_count = atoi(optarg); break;
+        case 'r': seed = atoi(optarg); break;
+        default: usage(argv[0]); exit(1);
+        }
+    }
+    if (optind < argc) {
+        usage(argv[0]);
+        exit(1);
+    }
+
+    if (thread_count > 0)
+        omp_set_num_threads(std::min(thread_count, omp_get_max_threads()));
+
+    printf("----------------------------------------------------------\n");
+    printf("Running with %d threads\n", omp_get_max_threads());
+    printf("----------------------------------------------------------\n");
+
+    Graph g;
+    double start = CycleTimer::currentSeconds();
+    if (graph_filename.empty()) {
+        if (scale < 1 || scale > 30 || 2 * ((long long)edgefactor << scale) > INT_MAX) {
+            std::cerr << "scale/edgefactor too large for 32-bit edge ids\n";
+            exit(1);
+        }
+        printf("Generating Kronecker graph...\n");
+        g = generate_kronecker(scale, edgefactor, seed);
+        printf("SCALE:                %d\n", scale);
+        printf("edgefactor:           %d\n", edgefactor);
+    } else {
+        printf("Loading graph...\n");
+        g = load_graph_binary(graph_filename.c_str());
+    }
+    double construction_time = CycleTimer::currentSeconds() - start;
+    printf("Nodes:                %d\n", g->num_nodes);
+    printf("Edges:                %d%s\n", g->num_edges, symmetric ? " (both directions)" : "");
+    printf("construction_time:    %.6f\n", construction_time);
+
+    // roots are distinct random vertices with at least one edge
+    std::vector<Vertex> candidates;
+    for (int v = 0; v < g->num_nodes; v++) {
+        if (outgoing_degree(g, v) > 0)
+            candidates.push_back(v);
+    }
+    std::shuffle(candidates.begin(), candidates.end(), std::mt19937(seed));
+    num_roots = std::min(num_roots, (int)candidates.size());
+    printf("NBFS:                 %d\n", num_roots);
+    if (num_roots == 0) {
+        std::cerr << "Graph has no edges\n";
+        exit(1);
+    }
+
+    solution sol;
+    sol.distances = (int*)malloc(sizeof(int) * g->num_nodes);
+    int* parents = (int*)malloc(sizeof(int) * g->num_nodes);
+
+    std::stringstream summary;
+    summary << "Kernel      Harmonic mean TEPS   Median TEPS   Mean time   Valid\n";
+    bool all_valid = true;
+
+    for (int k = 0; k < num_kernels; k++) {
+        std::vector<double> teps;
+        double total_time = 0;
+        bool valid = true;
+        for (int r = 0; r < num_roots; r++) {
+            Vertex root = candidates[r];
+            start = CycleTimer::currentSeconds();
+            kernels[k].run(g, root, &sol, parents);
+            double time = CycleTimer::currentSeconds() - start;
+
+            if (!validate(g, root, sol.distances, kernels[k].tree ? parents : NULL))
+                valid = false;
+            teps.push_back(traversed_edges(g, sol.distances, symmetric) / time);
+            total_time += time;
+        }
+        double hmean = print_stats(kernels[k].name, teps, total_time / num_roots);
+        printf("validation:           %s\n", valid ? "passed" : "FAILED");
+
+        char buf[1024];
+        sprintf(buf, "%-10s  %18.4g   %11.4g   %9.6f   %s\n", kernels[k].name,
+                hmean, quartile(teps, 0.5), total_time / num_roots, valid ? "yes" : "NO");
+        summary << buf;
+        all_valid = all_valid && valid;
+    }
+
+    printf("----------------------------------------------------------\n");
+    std::cout << "TEPS Summary" << std::endl;
+    std::cout << summary.str();
+    printf("----------------------------------------------------------\n");
+
+    free(sol.distances);
+    free(parents);
+    free_graph(g);
+
+    return all_valid ? 0 : 1;
+}
@@ -0,0 +1,130 @@
+#include "khop.h"
+
+#include <algorithm>
+#include <climits>
+#include <omp.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common/graph.h"
+
+// Levels with fewer frontier edges than this are expanded serially;
+// below it the fork/join costs more than the level itself.
+#define PARALLEL_EDGES 16384
+// Per-thread buffer for newly reached vertices in a parallel level
+#define LOCAL_BUFFER 256
+
+void khop_workspace_init(khop_workspace *ws, Graph graph) {
+  ws->num_nodes = graph->num_nodes;
+  ws->epoch = 0;
+  ws->marks = (unsigned int *)calloc(graph->num_nodes, sizeof(unsigned int));
+  ws->vertices = (Vertex *)malloc(sizeof(Vertex) * graph->num_nodes);
+  ws->count = 0;
+  ws->level_starts.clear();
+}
+
+void khop_workspace_free(khop_workspace *ws) {
+  free(ws->marks);
+  free(ws->vertices);
+}
+
+// Start a new query.  Only when the epoch wraps around are the marks
+// cleared, once every 2^32 queries.
+static void next_epoch(khop_workspace *ws) {
+  if (ws->epoch == UINT_MAX) {
+    memset(ws->marks, 0, sizeof(unsigned int) * ws->num_nodes);
+    ws->epoch = 0;
+  }
+  ws->epoch++;
+  ws->count = 0;
+  ws->level_starts.clear();
+}
+
+static void expand_serial(Graph g, khop_workspace *ws, int begin, int end) {
+  unsigned int epoch = ws->epoch;
+  for (int i = begin; i < end; i++) {
+    Vertex node = ws->vertices[i];
+    const Vertex *stop = outgoing_end(g, node);
+    for (const Vertex *w = outgoing_begin(g, node); w != stop; w++) {
+      if (ws->marks[*w] != epoch) {
+        ws->marks[*w] = epoch;
+        ws->vertices[ws->count++] = *w;
+      }
+    }
+  }
+}
+
+static void expand_parallel(Graph g, khop_workspace *ws, int begin, int end) {
+  unsigned int epoch = ws->epoch;
+  #pragma omp parallel
+  {
+    Vertex local[LOCAL_BUFFER];
+    int localCount = 0;
+    #pragma omp for schedule(dynamic, 64)
+    for (int i = begin; i < end; i++) {
+      Vertex node = ws->vertices[i];
+      const Vertex *stop = outgoing_end(g, node);
+      for (const Vertex *w = outgoing_begin(g, node); w != stop; w++) {
+        unsigned int mark = ws->marks[*w];
+        if (mark != epoch && __sync_bool_compare_and_swap(&ws->marks[*w], mark, epoch)) {
+          local[localCount++] = *w;
+          if (localCount == LOCAL_BUFFER) {
+            int index = __sync_fetch_and_add(&ws->count, localCount);
+            memcpy(ws->vertices + index, local, sizeof(Vertex) * localCount);
+            localCount = 0;
+          }
+        }
+      }
+    }
+    int index = __sync_fetch_and_add(&ws->count, localCount);
+    memcpy(ws->vertices + index, local, sizeof(Vertex) * localCount);
+  }
+}
+
+int khop_query(Graph graph, const Vertex *seeds, int num_seeds, int max_hops,
+               khop_workspace *ws) {
+  next_epoch(ws);
+  for (int s = 0; s < num_seeds; s++) {
+    if (ws->marks[seeds[s]] != ws->epoch) {
+      ws->marks[seeds[s]] = ws->epoch;
+      ws->vertices[ws->count++] = seeds[s];
+    }
+  }
+  ws->level_starts.push_back(0);
+  ws->level_starts.push_back(ws->count);
+
+  bool nested = omp_in_parallel();
+  for (int hop = 0; max_hops < 0 || hop < max_hops; hop++) {
+    int begin = ws->level_starts[hop];
+    int end = ws->level_starts[hop + 1];
+    if (begin == end)
+      break;
+    long long edges = 0;
+    if (!nested) {
+      for (int i = begin; i < end && edges < PARALLEL_EDGES; i++)
+        edges += outgoing_degree(graph, ws->vertices[i]);
+    }
+    if (edges >= PARALLEL_EDGES)
+      expand_parallel(graph, ws, begin, end);
+    else
+      expand_serial(graph, ws, begin, end);
+    ws->level_starts.push_back(ws->count);
+  }
+  // an empty last level carries no information
+  while (ws->level_starts.size() > 2 &&
+         ws->level_starts[ws->level_starts.size() - 2] == ws->count)
+    ws->level_starts.pop_back();
+  return ws->count;
+}
+
+int khop_hops(const khop_workspace *ws, int i) {
+  return std::upper_bound(ws->level_starts.begin(), ws->level_starts.end(), i) -
+         ws->level_starts.begin() - 1;
+}
+
+void khop_to_bitmap(const khop_workspace *ws, uint64_t *bitmap) {
+  for (int i = 0; i < ws->count; i++) {
+    Vertex v = ws->vertices[i];
+    bitmap[v / 64] |= (uint64_t)1 << (v % 64);
+  }
+}
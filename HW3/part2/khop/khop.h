@@ -0,0 +1,50 @@
+#ifndef __KHOP_H__
+#define __KHOP_H__
+
+#include <stdint.h>
+#include <vector>
+
+#include "common/graph.h"
+
+// Bounded multi-seed BFS: the vertices within max_hops of any seed.
+// A negative max_hops explores everything reachable from the seeds.
+#define KHOP_UNBOUNDED -1
+
+// Reusable state for queries on one graph, one workspace per thread.
+// Visited marks are epoch stamps, so nothing is cleared between
+// queries and a query costs time proportional to the neighborhood it
+// explores, not to num_nodes.
+struct khop_workspace {
+  int num_nodes;
+  unsigned int epoch;
+  // marks[v] == epoch iff the last query reached v
+  unsigned int *marks;
+  // reached vertices in BFS order (seeds first); hop h holds
+  // vertices[level_starts[h] .. level_starts[h+1])
+  Vertex *vertices;
+  int count;
+  std::vector<int> level_starts;
+};
+
+void khop_workspace_init(khop_workspace* ws, Graph graph);
+void khop_workspace_free(khop_workspace* ws);
+
+// Runs the query and returns the number of vertices reached; the
+// result stays in ws until its next query.  Levels whose frontier has
+// many edges are expanded in parallel unless the caller is already in
+// a parallel region (serving one query per thread).
+int khop_query(Graph graph, const Vertex* seeds, int num_seeds, int max_hops,
+               khop_workspace* ws);
+
+static inline bool khop_contains(const khop_workspace* ws, Vertex v) {
+  return ws->marks[v] == ws->epoch;
+}
+
+// Hops from the nearest seed to the i-th reached vertex
+int khop_hops(const khop_workspace* ws, int i);
+
+// Sets the bit of every reached vertex in bitmap (num_nodes bits,
+// cleared by the caller).  Costs time proportional to the result.
+void khop_to_bitmap(const khop_workspace* ws, uint64_t* bitmap);
+
+#endif
@@ -0,0 +1,189 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <omp.h>
+#include <string>
+#include <getopt.h>
+
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <vector>
+
+#include "common/CycleTimer.h"
+#include "common/graph.h"
+#include "breadth_first_search/bfs.h"
+#include "khop.h"
+
+#define DEFAULT_HOPS 2
+#define DEFAULT_SEEDS 1
+#define DEFAULT_QUERIES 10000
+#define DEFAULT_SEED 15418
+// Queries checked against full BFS, and full BFS runs timed for the
+// baseline (they are slow)
+#define NUM_CHECKS 16
+
+// Against the minimum over full BFS from each seed: a vertex must be
+// reached iff its distance is within max_hops, at that many hops.
+static bool check_query(Graph g, const Vertex* seeds, int num_seeds, int max_hops,
+                        const khop_workspace& ws, solution& sol, std::vector<int>& nearest)
+{
+    std::fill(nearest.begin(), nearest.end(), -1);
+    for (int s = 0; s < num_seeds; s++) {
+        bfs_top_down_from(g, seeds[s], &sol);
+        for (int v = 0; v < g->num_nodes; v++) {
+            int d = sol.distances[v];
+            if (d >= 0 && (nearest[v] < 0 || d < nearest[v]))
+                nearest[v] = d;
+        }
+    }
+    int expected = 0;
+    for (int v = 0; v < g->num_nodes; v++) {
+        bool within = nearest[v] >= 0 && (max_hops < 0 || nearest[v] <= max_hops);
+        if (within)
+            expected++;
+        if (within != khop_contains(&ws, v)) {
+            fprintf(stderr, "*** Vertex %d at distance %d %s\n", v, nearest[v],
+                    within ? "missing" : "reached");
+            return false;
+        }
+    }
+    if (expected != ws.count) {
+        fprintf(stderr, "*** Reached %d vertices, expected %d\n", ws.count, expected);
+        return false;
+    }
+    for (int i = 0; i < ws.count; i++) {
+        if (khop_hops(&ws, i) != nearest[ws.vertices[i]]) {
+            fprintf(stderr, "*** Vertex %d at %d hops, distance %d\n",
+                    ws.vertices[i], khop_hops(&ws, i), nearest[ws.vertices[i]]);
+            return false;
+        }
+    }
+    return true;
+}
+
+static void usage(const char* binary)
+{
+    std::cerr << "Usage: " << binary << " <path/to/graph/file> [-k hops] [-s seeds] [-q queries] [-t threads] [-r seed]\n";
+    std::cerr << "  -k: hop bound, " << KHOP_UNBOUNDED << " for reachability (default " << DEFAULT_HOPS << ")\n";
+    std::cerr << "  -s: random seed vertices per query (default " << DEFAULT_SEEDS << ")\n";
+    std::cerr << "  -q: number of random queries (default " << DEFAULT_QUERIES << ")\n";
+}
+
+int main(int argc, char** argv) {
+
+    int max_hops = DEFAULT_HOPS;
+    int num_seeds = DEFAULT_SEEDS;
+    int num_queries = DEFAULT_QUERIES;
+    int thread_count = -1;
+    unsigned int seed = DEFAULT_SEED;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "k:s:q:t:r:h")) != -1) {
+        switch (opt) {
+        case 'k': max_hops = atoi(optarg); break;
+        case 's': num_seeds = atoi(optarg); break;
+        case 'q': num_queries = atoi(optarg); break;
+        case 't': thread_count = atoi(optarg); break;
+        case 'r': seed = atoi(optarg); break;
+        default: usage(argv[0]); exit(1);
+        }
+    }
+    if (optind + 1 != argc || num_seeds < 1 || num_queries < 1) {
+        usage(argv[0]);
+        exit(1);
+    }
+    std::string graph_filename = argv[optind];
+
+    if (thread_count > 0)
+        omp_set_num_threads(std::min(thread_count, omp_get_max_threads()));
+    int threads = omp_get_max_threads();
+
+    printf("----------------------------------------------------------\n");
+    printf("Running with %d threads\n", threads);
+    printf("----------------------------------------------------------\n");
+
+    printf("Loading graph...\n");
+    Graph g = load_graph_binary(graph_filename.c_str());
+    printf("\n");
+    printf("Graph stats:\n");
+    printf("  Edges: %d\n", g->num_edges);
+    printf("  Nodes: %d\n", g->num_nodes);
+    printf("Queries: %d of %d seed(s), %d hops\n", num_queries, num_seeds, max_hops);
+
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> pick(0, g->num_nodes - 1);
+    std::vector<Vertex> seeds((size_t)num_queries * num_seeds);
+    for (size_t i = 0; i < seeds.size(); i++)
+        seeds[i] = pick(rng);
+
+    std::vector<khop_workspace> workspaces(threads);
+    for (int t = 0; t < threads; t++)
+        khop_workspace_init(&workspaces[t], g);
+    khop_workspace& ws = workspaces[0];
+
+    solution sol;
+    sol.distances = (int*)malloc(sizeof(int) * g->num_nodes);
+    std::vector<int> nearest(g->num_nodes);
+
+    // correctness, and the full-BFS baseline: one BFS per seed
+    std::cout << "Testing Correctness of k-hop queries\n";
+    bool check = true;
+    int num_checks = std::min(num_queries, NUM_CHECKS);
+    for (int q = 0; q < num_checks && check; q++) {
+        const Vertex* query = &seeds[(size_t)q * num_seeds];
+        khop_query(g, query, num_seeds, max_hops, &ws);
+        check = check_query(g, query, num_seeds, max_hops, ws, sol, nearest);
+    }
+    double start = CycleTimer::currentSeconds();
+    for (int q = 0; q < num_checks; q++) {
+        for (int s = 0; s < num_seeds; s++)
+            bfs_top_down_from(g, seeds[(size_t)q * num_seeds + s], &sol);
+    }
+    double full_time = (CycleTimer::currentSeconds() - start) / num_checks;
+
+    // one query at a time, each expanding large levels in parallel
+    long long reached = 0;
+    start = CycleTimer::currentSeconds();
+    for (int q = 0; q < num_queries; q++)
+        reached += khop_query(g, &seeds[(size_t)q * num_seeds], num_seeds, max_hops, &ws);
+    double intra_time = CycleTimer::currentSeconds() - start;
+
+    // one query per thread, each with its own workspace
+    start = CycleTimer::currentSeconds();
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (int q = 0; q < num_queries; q++)
+        khop_query(g, &seeds[(size_t)q * num_seeds], num_seeds, max_hops,
+                   &workspaces[omp_get_thread_num()]);
+    double inter_time = CycleTimer::currentSeconds() - start;
+
+    std::stringstream timing;
+    char buf[1024];
+    timing << "Mode                    Time/query (s)   Queries/sec   vs. Full BFS\n";
+    sprintf(buf, "%-22s  %14.8f   %11.1f   %.2fx\n", "Full BFS",
+            full_time, 1.0 / full_time, 1.0);
+    timing << buf;
+    sprintf(buf, "%-22s  %14.8f   %11.1f   %.2fx\n", "k-hop (intra-query)",
+            intra_time / num_queries, num_queries / intra_time,
+            full_time * num_queries / intra_time);
+    timing << buf;
+    sprintf(buf, "%-22s  %14.8f   %11.1f   %.2fx\n", "k-hop (inter-query)",
+            inter_time / num_queries, num_queries / inter_time,
+            full_time * num_queries / inter_time);
+    timing << buf;
+
+    printf("----------------------------------------------------------\n");
+    printf("Mean neighborhood: %.1f vertices\n", (double)reached / num_queries);
+    std::cout << "Timing Summary" << std::endl;
+    std::cout << timing.str();
+    printf("----------------------------------------------------------\n");
+    if (!check)
+        std::cout << "k-hop Queries are not Correct" << std::endl;
+
+    for (int t = 0; t < threads; t++)
+        khop_workspace_free(&workspaces[t]);
+    free(sol.distances);
+    free_graph(g);
+
+    return 0;
+}
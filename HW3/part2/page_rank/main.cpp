@@ -1,10 +1,14 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <omp.h>
 #include <string>
 #include <getopt.h>
+#include <unistd.h>
 
+#include <algorithm>
 #include <iostream>
+#include <random>
 #include <sstream>
 #include <vector>
 
@@ -18,30 +22,565 @@
 
 #define PageRankDampening 0.3f
 #define PageRankConvergence 1e-7d
+#define PageRankFixedPointConvergence 1e-12
+// Relative error allowed per vertex for float scores
+#define FloatTolerance 1e-6
+
+// Personalized runs: a batch of one uniform and single-seed columns,
+// and the single-seed approximations
+#define PersonalizedBatch 8
+#define PersonalizedSeed 15418
+#define ForwardPushEpsilon 1e-9
+#define MonteCarloWalks (1 << 20)
+
+// Incremental runs: the shares of edges changed, half removed and half
+// added, and the temporary file the scores of the unchanged graph are
+// saved to
+#define PerturbedFraction 0.01
+#define SmallPerturbedFraction 0.0001
+#define PerturbSeed 15418
+#define ScoresTemplate "/tmp/page_rank_scores.XXXXXX"
+
+// Anderson mixing: the windows compared with the power method, and
+// the high damping it is for.  Runs go to a convergence tight enough
+// that any method's result is within compareApprox of the fixed point.
+#define AndersonWindowSmall 2
+#define AndersonWindow 5
+#define AcceleratedDampening 0.85
+#define AcceleratedConvergence 1e-11
+
+// Checkpointed runs (-c, -r): iterations between checkpoints unless -c
+// says otherwise, and the files they go to, after the graph's name
+#define CheckpointEvery 5
+#define CheckpointSuffix ".ckpt"
 
 void reference_pageRank(Graph g, double* solution, double damping, double convergence);
 
+// Alternative implementations, checked against the reference result
+struct pr_variant {
+    const char* name;
+    // converges towards the fixed point by another path than pageRank's
+    // iterates, so it is checked against a fully converged reference
+    bool fixed_point;
+    // if not 0, scores only have to be within this relative error
+    double tolerance;
+    void (*run)(Graph g, double* solution, double damping, double convergence,
+                pr_stats* stats);
+};
+
+static const pr_variant variants[] = {
+    {"Pull (Jacobi)", false, 0, [](Graph g, double* solution, double damping, double convergence,
+                         pr_stats* stats) {
+        pageRank(g, solution, damping, convergence, stats);
+    }},
+    {"Push (blocked)", false, 0, [](Graph g, double* solution, double damping, double convergence,
+                          pr_stats* stats) {
+        pageRankPush(g, solution, damping, convergence, stats);
+    }},
+    {"Delta (Jacobi)", false, 0, [](Graph g, double* solution, double damping, double convergence,
+                          pr_stats* stats) {
+        pageRankDelta(g, solution, damping, convergence, false, stats);
+    }},
+    {"Delta (Gauss-Seidel)", true, 0, [](Graph g, double* solution, double damping, double convergence,
+                                pr_stats* stats) {
+        pageRankDelta(g, solution, damping, convergence, true, stats);
+    }},
+    {"Float (mixed)", false, FloatTolerance, [](Graph g, double* solution, double damping,
+                                                double convergence, pr_stats* stats) {
+        pageRankFloat(g, solution, damping, convergence, stats);
+    }},
+};
+static const int num_variants = sizeof(variants) / sizeof(variants[0]);
+
+static void format_variant(std::stringstream& timing, int threads, const char* name,
+                           double time, double pagerank_time, const pr_stats& stats)
+{
+    char buf[1024];
+    sprintf(buf, "%4d:    %-24s %.4f (%.2fx)  %10d  %14lld\n",
+            threads, name, time, pagerank_time/time, stats.iterations, stats.edges);
+    timing << buf;
+}
+
+// Reports the largest relative and the total error against the
+// reference, and whether every vertex is within tolerance
+static bool compareRelative(Graph g, const double* reference, const double* sol,
+                            double tolerance)
+{
+    double worst = 0, total = 0;
+    for (int i = 0; i < g->num_nodes; i++) {
+        double error = fabs(sol[i] - reference[i]);
+        total += error;
+        worst = std::max(worst, error / reference[i]);
+    }
+    printf("  max relative error %.2e, L1 error %.2e\n", worst, total);
+    if (worst > tolerance) {
+        fprintf(stderr, "*** Relative error %g above %g\n", worst, tolerance);
+        return false;
+    }
+    return true;
+}
+
+// The first row is the driver's main run, pageRankAuto, which the
+// others are measured against; pull and push also get a row each, so
+// both are timed whichever the graph's shape picks
+static void run_variants(Graph g, int threads, double* reference, double pagerank_time,
+                         const pr_stats& pagerank_stats,
+                         std::stringstream& timing, std::vector<bool>& checks)
+{
+    format_variant(timing, threads, pageRankPrefersPush(g) ? "Page Rank (auto: push)"
+                                                           : "Page Rank (auto: pull)",
+                   pagerank_time, pagerank_time, pagerank_stats);
+    double* sol = (double*)malloc(sizeof(double) * g->num_nodes);
+    double* fixed_point = (double*)malloc(sizeof(double) * g->num_nodes);
+    reference_pageRank(g, fixed_point, PageRankDampening, PageRankFixedPointConvergence);
+    for (int v = 0; v < num_variants; v++) {
+        pr_stats stats;
+        double start = CycleTimer::currentSeconds();
+        variants[v].run(g, sol, PageRankDampening, PageRankConvergence, &stats);
+        double time = CycleTimer::currentSeconds() - start;
+
+        std::cout << "Testing Correctness of " << variants[v].name << "\n";
+        if (variants[v].tolerance) {
+            if (!compareRelative(g, reference, sol, variants[v].tolerance))
+                checks[v] = false;
+        } else if (!compareApprox(g, variants[v].fixed_point ? fixed_point : reference, sol)) {
+            checks[v] = false;
+        }
+
+        format_variant(timing, threads, variants[v].name, time, pagerank_time, stats);
+    }
+    free(sol);
+    free(fixed_point);
+}
+
+static void print_variants(std::stringstream& timing, std::vector<bool>& checks)
+{
+    std::cout << "Variants: Timing Summary (speedup vs. Page Rank)" << std::endl;
+    std::cout << timing.str();
+    for (int v = 0; v < num_variants; v++) {
+        if (!checks[v])
+            std::cout << variants[v].name << " is not Correct" << std::endl;
+    }
+    printf("----------------------------------------------------------\n");
+}
+
+// The uniform teleport must reproduce the reference, each column of the
+// batch must match its own single run, and the approximations are
+// measured against the exact column of their seed.
+static void run_personalized(Graph g, double* reference)
+{
+    int n = g->num_nodes;
+    int k = PersonalizedBatch;
+    std::vector<Vertex> seeds;
+    std::mt19937 rng(PersonalizedSeed);
+    while ((int)seeds.size() < k - 1) {
+        Vertex v = rng() % n;
+        if (outgoing_size(g, v) > 0)
+            seeds.push_back(v);
+    }
+    double* teleport = (double*)calloc((size_t)n * k, sizeof(double));
+    for (int v = 0; v < n; v++)
+        teleport[(size_t)v * k] = 1.0 / n;
+    for (int j = 1; j < k; j++)
+        teleport[(size_t)seeds[j - 1] * k + j] = 1.0;
+
+    double* batch = (double*)malloc(sizeof(double) * n * k);
+    double* column = (double*)malloc(sizeof(double) * n);
+    double* single = (double*)malloc(sizeof(double) * n);
+    double* exact = (double*)malloc(sizeof(double) * n);
+    bool check = true;
+
+    double start = CycleTimer::currentSeconds();
+    pageRankBatched(g, batch, teleport, k, PageRankDampening, PageRankConvergence);
+    double batch_time = CycleTimer::currentSeconds() - start;
+
+    double single_time = 0;
+    for (int j = 0; j < k; j++) {
+        for (int v = 0; v < n; v++)
+            column[v] = teleport[(size_t)v * k + j];
+        start = CycleTimer::currentSeconds();
+        pageRankPersonalized(g, single, column, PageRankDampening, PageRankConvergence);
+        single_time += CycleTimer::currentSeconds() - start;
+
+        std::cout << "Testing Correctness of Personalized column " << j << "\n";
+        if (j == 0 && !compareApprox(g, reference, single))
+            check = false;
+        for (int v = 0; v < n; v++)
+            column[v] = batch[(size_t)v * k + j];
+        if (!compareApprox(g, single, column))
+            check = false;
+        if (j == 1)
+            memcpy(exact, single, sizeof(double) * n);
+    }
+
+    start = CycleTimer::currentSeconds();
+    pprForwardPush(g, seeds[0], PageRankDampening, ForwardPushEpsilon, single);
+    double push_time = CycleTimer::currentSeconds() - start;
+    double push_error = 0;
+    for (int v = 0; v < n; v++)
+        push_error += fabs(single[v] - exact[v]);
+    if (push_error > ForwardPushEpsilon * g->num_edges) {
+        fprintf(stderr, "*** Forward push L1 error %g above its bound\n", push_error);
+        check = false;
+    }
+
+    start = CycleTimer::currentSeconds();
+    pprMonteCarlo(g, seeds[0], PageRankDampening, MonteCarloWalks, PersonalizedSeed, single);
+    double walk_time = CycleTimer::currentSeconds() - start;
+    double walk_error = 0;
+    for (int v = 0; v < n; v++)
+        walk_error += fabs(single[v] - exact[v]);
+
+    std::cout << "Personalized: Timing Summary (seed " << seeds[0] << ")" << std::endl;
+    char label[64];
+    sprintf(label, "%d single runs", k);
+    printf("  %-28s %.4f\n", label, single_time);
+    sprintf(label, "Batch of %d", k);
+    printf("  %-28s %.4f (%.2fx)\n", label, batch_time, single_time/batch_time);
+    sprintf(label, "Forward push (eps %.0e)", ForwardPushEpsilon);
+    printf("  %-28s %.4f  L1 error %.2e\n", label, push_time, push_error);
+    sprintf(label, "Monte-Carlo (%d walks)", MonteCarloWalks);
+    printf("  %-28s %.4f  L1 error %.2e\n", label, walk_time, walk_error);
+    if (!check)
+        std::cout << "Personalized Page Rank is not Correct" << std::endl;
+    printf("----------------------------------------------------------\n");
+
+    free(teleport);
+    free(batch);
+    free(column);
+    free(single);
+    free(exact);
+}
+
+// A copy of g with fraction of its edges changed: half of them removed
+// at random, and as many random edges added.  The changes are listed
+// in changes.
+static Graph perturb_graph(Graph g, double fraction, std::vector<pr_edge_change>& changes)
+{
+    int n = g->num_nodes;
+    int m = g->num_edges;
+    int count = std::max(1, (int)(m * fraction / 2));
+    std::mt19937 rng(PerturbSeed);
+    std::vector<char> removed(m, 0);
+    std::vector<int> degrees(n);
+    for (int v = 0; v < n; v++)
+        degrees[v] = outgoing_size(g, v);
+    for (int c = 0; c < count && c < m; ) {
+        int e = rng() % m;
+        if (removed[e])
+            continue;
+        removed[e] = 1;
+        Vertex src = std::upper_bound(g->outgoing_starts, g->outgoing_starts + n, e)
+                     - g->outgoing_starts - 1;
+        changes.push_back({src, g->outgoing_edges[e], false});
+        degrees[src]--;
+        c++;
+    }
+    for (int c = 0; c < count; c++) {
+        Vertex src = rng() % n;
+        Vertex dst = rng() % n;
+        changes.push_back({src, dst, true});
+        degrees[src]++;
+    }
+
+    int* starts = (int*)malloc(sizeof(int) * (n + 1));
+    starts[0] = 0;
+    for (int v = 0; v < n; v++)
+        starts[v + 1] = starts[v] + degrees[v];
+    Vertex* edges = (Vertex*)malloc(sizeof(Vertex) * std::max(starts[n], 1));
+    std::vector<int> cursor(starts, starts + n);
+    for (int v = 0; v < n; v++) {
+        for (int e = g->outgoing_starts[v]; e < g->outgoing_starts[v] + outgoing_size(g, v); e++) {
+            if (!removed[e])
+                edges[cursor[v]++] = g->outgoing_edges[e];
+        }
+    }
+    for (const pr_edge_change& change : changes) {
+        if (change.added)
+            edges[cursor[change.src]++] = change.dst;
+    }
+    return graph_from_csr(n, starts[n], starts, edges);
+}
+
+// Scores for a graph with a few changed edges, started three ways: cold
+// from uniform, warm from the scores of the unchanged graph (through a
+// score file), and incrementally from the changed edges.  Warm and
+// incremental runs must land as close to the fixed point as the cold
+// one, within damping / (1 - damping) * convergence in L1 each.
+//
+// Incremental only beats warm when the changes stay local: on grids at
+// the small fraction.  On rmat even that reaches most of the graph, and
+// pageRankIncremental falls back to a warm start whenever the changes
+// reach more than a sixteenth of the edges, as at the large fraction;
+// its row is then labeled "Incremental (warm)".
+static void run_incremental(Graph g, double* scores, double fraction)
+{
+    std::vector<pr_edge_change> changes;
+    Graph changed = perturb_graph(g, fraction, changes);
+    int n = g->num_nodes;
+    double* cold = (double*)malloc(sizeof(double) * n);
+    double* warm = (double*)malloc(sizeof(double) * n);
+    double* incremental = (double*)malloc(sizeof(double) * n);
+    double bound = 2 * PageRankDampening / (1 - PageRankDampening) * PageRankConvergence;
+    bool check = true;
+
+    pr_stats stats[3];
+    double times[3];
+    double start = CycleTimer::currentSeconds();
+    pageRank(changed, cold, PageRankDampening, PageRankConvergence, &stats[0]);
+    times[0] = CycleTimer::currentSeconds() - start;
+
+    char scores_filename[] = ScoresTemplate;
+    int fd = mkstemp(scores_filename);
+    if (fd < 0 || close(fd) != 0 ||
+        !store_scores(scores_filename, g, scores) ||
+        !load_scores(scores_filename, changed, warm)) {
+        fprintf(stderr, "*** Could not save and reload %s\n", scores_filename);
+        memcpy(warm, scores, sizeof(double) * n);
+        check = false;
+    }
+    if (fd >= 0)
+        unlink(scores_filename);
+    start = CycleTimer::currentSeconds();
+    pageRankFrom(changed, warm, warm, PageRankDampening, PageRankConvergence, &stats[1]);
+    times[1] = CycleTimer::currentSeconds() - start;
+
+    memcpy(incremental, scores, sizeof(double) * n);
+    start = CycleTimer::currentSeconds();
+    bool local = pageRankIncremental(changed, incremental, changes.data(), changes.size(),
+                                     PageRankDampening, PageRankConvergence, &stats[2]);
+    times[2] = CycleTimer::currentSeconds() - start;
+
+    // an incremental run that fell back to a warm restart says so
+    const char* names[3] = {"Cold", "Warm (score file)",
+                            local ? "Incremental" : "Incremental (warm)"};
+    double* results[3] = {cold, warm, incremental};
+    std::cout << "Incremental: Timing Summary (" << changes.size() / 2 << " edges removed, "
+              << changes.size() / 2 << " added)" << std::endl;
+    std::cout << "Start                Time (Speedup)   Iterations           Edges  L1 vs. cold"
+              << std::endl;
+    for (int r = 0; r < 3; r++) {
+        double error = 0;
+        for (int v = 0; v < n; v++)
+            error += fabs(results[r][v] - cold[v]);
+        if (error > bound) {
+            fprintf(stderr, "*** %s run is %g from the cold run in L1\n", names[r], error);
+            check = false;
+        }
+        printf("%-20s %.4f (%.2fx)  %10d  %14lld     %.2e\n", names[r], times[r],
+               times[0]/times[r], stats[r].iterations, stats[r].edges, error);
+    }
+    if (!check)
+        std::cout << "Incremental Page Rank is not Correct" << std::endl;
+    printf("----------------------------------------------------------\n");
+
+    free(cold);
+    free(warm);
+    free(incremental);
+    free_graph(changed);
+}
+
+// pageRank and Anderson mixing, at the usual damping and at one where
+// the power method needs many iterations, each checked against the
+// fixed point
+static void run_accelerated(Graph g)
+{
+    int n = g->num_nodes;
+    double* fixed_point = (double*)malloc(sizeof(double) * n);
+    double* sol = (double*)malloc(sizeof(double) * n);
+    double dampings[2] = {PageRankDampening, AcceleratedDampening};
+    int windows[3] = {0, AndersonWindowSmall, AndersonWindow};
+    bool check = true;
+
+    std::stringstream timing;
+    timing << "Damping  Method               Time (Speedup)   Iterations           Edges\n";
+    for (int d = 0; d < 2; d++) {
+        reference_pageRank(g, fixed_point, dampings[d], PageRankFixedPointConvergence);
+        double power_time = 0;
+        for (int r = 0; r < 3; r++) {
+            char name[64];
+            if (windows[r] == 0)
+                sprintf(name, "Power");
+            else
+                sprintf(name, "Anderson (window %d)", windows[r]);
+            pr_stats stats;
+            double start = CycleTimer::currentSeconds();
+            if (windows[r] == 0)
+                pageRank(g, sol, dampings[d], AcceleratedConvergence, &stats);
+            else
+                pageRankAnderson(g, sol, windows[r], dampings[d], AcceleratedConvergence, &stats);
+            double time = CycleTimer::currentSeconds() - start;
+            if (r == 0)
+                power_time = time;
+
+            std::cout << "Testing Correctness of " << name << " at damping " << dampings[d] << "\n";
+            if (!compareApprox(g, fixed_point, sol))
+                check = false;
+            char buf[1024];
+            sprintf(buf, "%.2f     %-20s %.4f (%.2fx)  %10d  %14lld\n", dampings[d], name, time,
+                    power_time/time, stats.iterations, stats.edges);
+            timing << buf;
+        }
+    }
+    std::cout << "Accelerated: Timing Summary (convergence " << AcceleratedConvergence << ")"
+              << std::endl;
+    std::cout << timing.str();
+    if (!check)
+        std::cout << "Accelerated Page Rank is not Correct" << std::endl;
+    printf("----------------------------------------------------------\n");
+
+    free(fixed_point);
+    free(sol);
+}
+
+// A single pageRank run that checkpoints its scores as it goes, from
+// uniform or, with resume, from the newest valid checkpoint of an
+// earlier run.  It is timed against a run without checkpoints and
+// checked against the reference like the main run.
+static void run_checkpointed(Graph g, const std::string& graph_filename, int every, bool resume)
+{
+    int n = g->num_nodes;
+    double* scores = (double*)malloc(sizeof(double) * n);
+    double* plain = (double*)malloc(sizeof(double) * n);
+    double* reference = (double*)malloc(sizeof(double) * n);
+    std::string prefix = graph_filename + CheckpointSuffix;
+
+    bool resumed = false;
+    int first_iteration = 0;
+    int resumed_slot = -1;
+    if (resume) {
+        resumed = load_checkpoint(prefix.c_str(), g, scores, &first_iteration, &resumed_slot);
+        if (resumed)
+            printf("Resuming from the checkpoint of iteration %d\n", first_iteration);
+        else
+            printf("No valid checkpoint in %s.*, starting from uniform\n", prefix.c_str());
+    }
+
+    pr_stats stats;
+    pr_stats plain_stats;
+    int written, skipped;
+    pr_checkpointer* checkpointer = checkpointer_create(prefix.c_str(), g, every, first_iteration,
+                                                        resumed_slot);
+    double start = CycleTimer::currentSeconds();
+    pageRankFrom(g, scores, resumed ? scores : NULL, PageRankDampening, PageRankConvergence,
+                 &stats, checkpointer_offer, checkpointer);
+    double time = CycleTimer::currentSeconds() - start;
+    // the write still in flight is not part of the computation's time
+    checkpointer_destroy(checkpointer, &written, &skipped);
+
+    start = CycleTimer::currentSeconds();
+    pageRank(g, plain, PageRankDampening, PageRankConvergence, &plain_stats);
+    double plain_time = CycleTimer::currentSeconds() - start;
+    reference_pageRank(g, reference, PageRankDampening, PageRankConvergence);
+
+    printf("----------------------------------------------------------\n");
+    std::cout << "Checkpointed: Timing Summary (every " << every << " iterations to "
+              << prefix << ".*)" << std::endl;
+    std::cout << "Run                  Time (Speedup)   Iterations  Checkpoints  Skipped" << std::endl;
+    printf("%-20s %.4f (%.2fx)  %10d\n", "Plain", plain_time, 1.0, plain_stats.iterations);
+    printf("%-20s %.4f (%.2fx)  %10d  %11d  %7d\n", resumed ? "Resumed" : "Checkpointed",
+           time, plain_time/time, first_iteration + stats.iterations, written, skipped);
+    std::cout << "Testing Correctness of Checkpointed Page Rank\n";
+    if (!compareApprox(g, reference, scores))
+        std::cout << "Checkpointed Page Rank is not Correct" << std::endl;
+    printf("----------------------------------------------------------\n");
+
+    free(scores);
+    free(plain);
+    free(reference);
+}
+
+// A single pageRank run from the scores in warm_filename, if given and
+// valid for g, or from uniform, storing its result in store_filename,
+// if given: today's run warm-starts from yesterday's scores.  It is
+// checked against the reference like the main run.
+static void run_saved(Graph g, const char* warm_filename, const char* store_filename)
+{
+    int n = g->num_nodes;
+    double* scores = (double*)malloc(sizeof(double) * n);
+    double* reference = (double*)malloc(sizeof(double) * n);
+
+    bool warm = false;
+    if (warm_filename) {
+        warm = load_scores(warm_filename, g, scores);
+        if (warm)
+            printf("Warm start from %s\n", warm_filename);
+        else
+            printf("No valid scores in %s, starting from uniform\n", warm_filename);
+    }
+
+    pr_stats stats;
+    double start = CycleTimer::currentSeconds();
+    pageRankFrom(g, scores, warm ? scores : NULL, PageRankDampening, PageRankConvergence, &stats);
+    double time = CycleTimer::currentSeconds() - start;
+    reference_pageRank(g, reference, PageRankDampening, PageRankConvergence);
+
+    printf("----------------------------------------------------------\n");
+    std::cout << "Saved scores: Timing Summary" << std::endl;
+    std::cout << "Start                Time   Iterations           Edges" << std::endl;
+    printf("%-20s %.4f  %10d  %14lld\n", warm ? "Warm" : "Uniform", time, stats.iterations,
+           stats.edges);
+    std::cout << "Testing Correctness of Page Rank\n";
+    if (!compareApprox(g, reference, scores))
+        std::cout << "Page Rank is not Correct" << std::endl;
+    if (store_filename) {
+        if (store_scores(store_filename, g, scores))
+            printf("Scores stored in %s\n", store_filename);
+        else
+            fprintf(stderr, "*** Could not write %s\n", store_filename);
+    }
+    printf("----------------------------------------------------------\n");
+
+    free(scores);
+    free(reference);
+}
+
+static void usage(const char* binary)
+{
+    std::cerr << "Usage: " << binary << " [-c every] [-r] [-w scores] [-s scores] <path/to/graph/file> [num_threads]\n";
+    std::cerr << "  To run results for all thread counts: <path/to/graph/file>\n";
+    std::cerr << "  Run with a certain number of threads (no correctness run): <path/to/graph/file> <num_threads>\n";
+    std::cerr << "  -c: only run Page Rank, checkpointing every so many iterations (default "
+              << CheckpointEvery << ")\n";
+    std::cerr << "  -r: as -c, resuming from the newest valid checkpoint\n";
+    std::cerr << "  -w: only run Page Rank, warm-started from the scores in this file\n";
+    std::cerr << "  -s: only run Page Rank, storing its scores in this file (with -w, may be the same)\n";
+}
 
 int main(int argc, char** argv) {
 
     int  num_threads = -1;
     std::string graph_filename;
 
-    if (argc < 2)
+    int checkpoint_every = 0;
+    bool resume = false;
+    const char* warm_filename = NULL;
+    const char* store_filename = NULL;
+    int opt;
+    while ((opt = getopt(argc, argv, "c:rw:s:h")) != -1) {
+        switch (opt) {
+        case 'c': checkpoint_every = atoi(optarg); break;
+        case 'r': resume = true; break;
+        case 'w': warm_filename = optarg; break;
+        case 's': store_filename = optarg; break;
+        default: usage(argv[0]); exit(1);
+        }
+    }
+    if (optind >= argc || argc - optind > 2)
     {
-        std::cerr << "Usage: <path/to/graph/file> [num_threads]\n";
-        std::cerr << "  To run results for all thread counts: <path/to/graph/file>\n";
-        std::cerr << "  Run with a certain number of threads (no correctness run): <path/to/graph/file> <num_threads>\n";
+        usage(argv[0]);
         exit(1);
     }
+    if (resume && checkpoint_every <= 0)
+        checkpoint_every = CheckpointEvery;
 
     int thread_count = -1;
-    if (argc == 3)
+    if (argc - optind == 2)
     {
-        thread_count = atoi(argv[2]);
+        thread_count = atoi(argv[optind + 1]);
     }
 
-    graph_filename = argv[1];
+    graph_filename = argv[optind];
 
     Graph g;
 
@@ -58,7 +597,7 @@ int main(int argc, char** argv) {
     if (USE_BINARY_GRAPH) {
       g = load_graph_binary(graph_filename.c_str());
     } else {
-        g = load_graph(argv[1]);
+        g = load_graph(graph_filename.c_str());
         printf("storing binary form of graph!\n");
         store_graph_binary(graph_filename.append(".bin").c_str(), g);
         free_graph(g);
@@ -68,6 +607,29 @@ int main(int argc, char** argv) {
     printf("Graph stats:\n");
     printf("  Edges: %d\n", g->num_edges);
     printf("  Nodes: %d\n", g->num_nodes);
+    printf("  Shape favors: %s\n", pageRankPrefersPush(g) ? "push" : "pull");
+
+    if (checkpoint_every > 0)
+    {
+        if (thread_count > 0)
+            omp_set_num_threads(thread_count);
+        run_checkpointed(g, graph_filename, checkpoint_every, resume);
+        free_graph(g);
+        return 0;
+    }
+    if (warm_filename || store_filename)
+    {
+        if (thread_count > 0)
+            omp_set_num_threads(thread_count);
+        run_saved(g, warm_filename, store_filename);
+        free_graph(g);
+        return 0;
+    }
+
+    std::stringstream variant_timing;
+    variant_timing << "Threads    Variant                  Time (Speedup)   Iterations           Edges\n";
+    std::vector<bool> variant_checks(num_variants, true);
+    pr_stats pagerank_stats;
 
     //If we want to run on all threads
     if (thread_count <= -1)
@@ -122,7 +684,7 @@ int main(int argc, char** argv) {
 
             //Run implementations
             start = CycleTimer::currentSeconds();
-            pageRank(g, sol1, PageRankDampening, PageRankConvergence);
+            pageRankAuto(g, sol1, PageRankDampening, PageRankConvergence, &pagerank_stats);
             pagerank_time = CycleTimer::currentSeconds() - start;
 
             //Run staff reference implementation
@@ -140,6 +702,8 @@ int main(int argc, char** argv) {
             if (!compareApprox(g, sol4, sol1)) {
               pr_check = false;
             }
+            run_variants(g, num_threads[i], sol4, pagerank_time, pagerank_stats,
+                         variant_timing, variant_checks);
 
             char buf[1024];
             char ref_buf[1024];
@@ -169,6 +733,12 @@ int main(int argc, char** argv) {
         if (!pr_check)
             std::cout << "Page Rank is not Correct" << std::endl;
         std::cout << std::endl << "Relative Speedup to Reference: " << std::endl <<  relative_timing.str();
+        printf("----------------------------------------------------------\n");
+        print_variants(variant_timing, variant_checks);
+        run_personalized(g, sol4);
+        run_incremental(g, sol1, PerturbedFraction);
+        run_incremental(g, sol1, SmallPerturbedFraction);
+        run_accelerated(g);
     }
     //Run the code with only one thread count and only report speedup
     else
@@ -205,7 +775,7 @@ int main(int argc, char** argv) {
 
         //Run implementations
         start = CycleTimer::currentSeconds();
-        pageRank(g, sol1, PageRankDampening, PageRankConvergence);
+        pageRankAuto(g, sol1, PageRankDampening, PageRankConvergence, &pagerank_stats);
         pagerank_time = CycleTimer::currentSeconds() - start;
 
         //Run reference implementation
@@ -217,6 +787,8 @@ int main(int argc, char** argv) {
         if (!compareApprox(g, sol4, sol1)) {
           pr_check = false;
         }
+        run_variants(g, thread_count, sol4, pagerank_time, pagerank_stats,
+                         variant_timing, variant_checks);
 
 
         char buf[1024];
@@ -238,6 +810,11 @@ int main(int argc, char** argv) {
         std::cout << "Reference: Timing Summary" << std::endl;
         std::cout << ref_timing.str();
         printf("----------------------------------------------------------\n");
+        print_variants(variant_timing, variant_checks);
+        run_personalized(g, sol4);
+        run_incremental(g, sol1, PerturbedFraction);
+        run_incremental(g, sol1, SmallPerturbedFraction);
+        run_accelerated(g);
     }
 
     free_graph(g);
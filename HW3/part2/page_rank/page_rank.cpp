@@ -1,101 +1,134 @@
 #include "page_rank.h"
 
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <cmath>
 #include <omp.h>
 #include <utility>
 
 #include "../common/CycleTimer.h"
 #include "../common/graph.h"
+#include "../common/partition.h"
+#include "page_rank_gather.h"
 
-// pageRank --
-//
-// g:           graph to process (see common/graph.h)
-// solution:    array of per-vertex vertex scores (length of array is num_nodes(g))
-// damping:     page-rank algorithm's damping parameter
-// convergence: page-rank algorithm's convergence threshold
+// First word of a score file, followed by the vertex count and the scores
+#define SCORES_HEADER_TOKEN 0xDEC0DE5C
+
+// pageRankFrom --
 //
-void pageRank(Graph g, double *solution, double damping, double convergence)
+// pageRank starting from the given scores instead of the uniform
+// distribution, which saves iterations when they are close to the
+// result, e.g. the scores of the graph before a few edges changed.
+// initial may be solution itself; NULL starts from uniform.
+// after_iteration, if given, sees the scores after every iteration.
+void pageRankFrom(Graph g, double *solution, const double *initial, double damping,
+                  double convergence, pr_stats *stats, pr_iteration_fn after_iteration,
+                  void *context)
 {
 
-  // initialize vertex weights to uniform probability. Double
-  // precision scores are used to avoid underflow for large graphs
+  // initialize vertex weights to uniform probability, or the given
+  // scores. Double precision scores are used to avoid underflow for
+  // large graphs
 
   int numNodes = num_nodes(g);
-  double *scoreOld = new double[numNodes];
   double equalProb = 1.0 / numNodes;
+  // scores are double buffered: each iteration reads one array and
+  // writes the other, then the two are swapped
+  double *scoreOld = solution;
+  double *scoreNew = new double[numNodes];
+  // contrib[v] = score[v] / outgoing degree of v, what v passes along
+  // each of its edges; 0 for vertices without outgoing edges.  Double
+  // buffered with the scores, so the edge loop is a pure gather-sum
+  // and the one division happens per vertex instead of per edge.
+  double *contribOld = new double[numNodes];
+  double *contribNew = new double[numNodes];
   int i = 0;
-  int dynamicChunk = numNodes / 100000;
-  const int chunkMin = 4, chunkMax = 10000;
-  if (dynamicChunk < chunkMin)
-  {
-    dynamicChunk = chunkMin;
-  }
-  else if (dynamicChunk > chunkMax)
-  {
-    dynamicChunk = chunkMax;
-  }
-  int cur = 0;
+  // equal incoming-edge work per part, since the pull loop's cost per
+  // vertex is its in-degree
+  int parts = omp_get_max_threads() * PARTS_PER_THREAD;
+  int *boundaries = new int[parts + 1];
+  partition_vertices(g->incoming_starts, numNodes, g->num_edges, parts, boundaries);
+  int part = 0;
+  // total score of the vertices without outgoing edges, which is
+  // spread evenly over all vertices in the next iteration.  It starts
+  // from the graph's dangling list; afterwards the fused pass sums it
+  // while it has each vertex's degree at hand anyway.
+  double noOutgoingScore = 0.0;
   #pragma omp parallel for private(i)
   for (i = 0; i < numNodes; ++i)
   {
-    solution[i] = equalProb;
+    int degree = outgoing_degree(g, i);
+    double score = initial ? initial[i] : equalProb;
+    scoreOld[i] = score;
+    contribOld[i] = (degree == 0) ? 0.0 : score / degree;
   }
+  for (i = 0; i < g->num_dangling; ++i)
+    noOutgoingScore += scoreOld[g->dangling_vertices[i]];
+  double teleport = (1.0 - damping) / numNodes;
+  int iterations = 0;
   bool converged = false;
   while (!converged) {
-    double golbalDiff = 0.0;
-    double noOutgoingSum = 0.0;
-    #pragma omp parallel
+    // one pass computes the new scores, their change and the dangling
+    // score the next iteration needs
+    double base = teleport + damping * noOutgoingScore / numNodes;
+    double globalDiff = 0.0;
+    double nextNoOutgoingScore = 0.0;
+    #pragma omp parallel for private(part) schedule(dynamic, 1) \
+      reduction(+: globalDiff, nextNoOutgoingScore)
+    for (part = 0; part < parts; ++part)
     {
-      #pragma omp for private(i)
-      for (i = 0; i < numNodes; ++i)
+      for (int cur = boundaries[part]; cur < boundaries[part + 1]; ++cur)
       {
-        scoreOld[i] = solution[i];
-        solution[i] = 0.0;
-      }
-      #pragma omp for private(cur) schedule(dynamic, dynamicChunk)
-      for (cur = 0; cur < numNodes; ++cur)
-      {
-        const Vertex *start = incoming_begin(g, cur);
-        size_t sizeIncome = incoming_size(g, cur);
-        for (size_t i = 0; i < sizeIncome; ++i)
-        {
-          Vertex v = start[i];
-          solution[cur] += scoreOld[v] / outgoing_size(g, v);
-        }
-      }
-      #pragma omp for private(i)
-      for (i = 0; i < numNodes; ++i)
-      {
-        solution[i] = damping * solution[i] + (1.0 - damping) / numNodes;
-      }
-      #pragma omp for private(i) reduction(+: noOutgoingSum)
-      for (i = 0; i < numNodes; ++i)
-      {
-        if (outgoing_size(g, i) == 0)
-        {
-          noOutgoingSum += damping * scoreOld[i] / numNodes;
-        }
-      }
-      #pragma omp for private(i)
-      for (i = 0; i < numNodes; ++i)
-      {
-        solution[i] += noOutgoingSum;
-      }
-      #pragma omp for private(i) reduction(+: golbalDiff)
-      for (i = 0; i < numNodes; ++i)
-      {
-        golbalDiff += abs(solution[i] - scoreOld[i]);
-      }
-      #pragma omp single
-      {
-        if (golbalDiff < convergence)
-        {
-          converged = true;
-        }
+        double sum = gather_contributions(incoming_begin(g, cur), incoming_size(g, cur),
+                                          contribOld);
+        double score = damping * sum + base;
+        int degree = outgoing_degree(g, cur);
+        scoreNew[cur] = score;
+        contribNew[cur] = (degree == 0) ? 0.0 : score / degree;
+        globalDiff += fabs(score - scoreOld[cur]);
+        if (degree == 0)
+          nextNoOutgoingScore += score;
       }
     }
+    std::swap(scoreOld, scoreNew);
+    std::swap(contribOld, contribNew);
+    noOutgoingScore = nextNoOutgoingScore;
+    converged = globalDiff < convergence;
+    iterations++;
+    if (after_iteration && !converged)
+      after_iteration(context, scoreOld, iterations);
+  }
+  if (stats) {
+    stats->iterations = iterations;
+    stats->edges = (long long)iterations * g->num_edges;
+  }
+  // the latest scores are in scoreOld after the swap
+  if (scoreOld != solution)
+  {
+    #pragma omp parallel for private(i)
+    for (i = 0; i < numNodes; ++i)
+      solution[i] = scoreOld[i];
+    scoreNew = scoreOld;
   }
+  delete[] scoreNew;
+  delete[] contribOld;
+  delete[] contribNew;
+  delete[] boundaries;
+}
+
+// pageRank --
+//
+// g:           graph to process (see common/graph.h)
+// solution:    array of per-vertex vertex scores (length of array is num_nodes(g))
+// damping:     page-rank algorithm's damping parameter
+// convergence: page-rank algorithm's convergence threshold
+// stats:       if not NULL, receives the iterations and edges processed
+//
+void pageRank(Graph g, double *solution, double damping, double convergence, pr_stats *stats)
+{
+  pageRankFrom(g, solution, NULL, damping, convergence, stats);
+
   /*
      For PP students: Implement the page rank algorithm here.  You
      are expected to parallelize the algorithm using openMP.  Your
@@ -125,3 +158,27 @@ void pageRank(Graph g, double *solution, double damping, double convergence)
 
    */
 }
+
+bool store_scores(const char *filename, Graph g, const double *scores)
+{
+  FILE *file = fopen(filename, "wb");
+  if (!file)
+    return false;
+  int header[2] = {(int)SCORES_HEADER_TOKEN, g->num_nodes};
+  bool ok = fwrite(header, sizeof(int), 2, file) == 2 &&
+            fwrite(scores, sizeof(double), g->num_nodes, file) == (size_t)g->num_nodes;
+  return fclose(file) == 0 && ok;
+}
+
+bool load_scores(const char *filename, Graph g, double *scores)
+{
+  FILE *file = fopen(filename, "rb");
+  if (!file)
+    return false;
+  int header[2];
+  bool ok = fread(header, sizeof(int), 2, file) == 2 &&
+            header[0] == (int)SCORES_HEADER_TOKEN && header[1] == g->num_nodes &&
+            fread(scores, sizeof(double), g->num_nodes, file) == (size_t)g->num_nodes;
+  fclose(file);
+  return ok;
+}
@@ -3,6 +3,102 @@
 
 #include "common/graph.h"
 
-void pageRank(Graph g, double* solution, double damping, double convergence);
+// Work done by a run: iterations (rounds, for the delta variants) and
+// edges traversed over all of them
+struct pr_stats {
+    int iterations;
+    long long edges;
+};
+
+// Called by pageRankFrom after every iteration that did not converge,
+// with the scores so far and the number of iterations done
+typedef void (*pr_iteration_fn)(void* context, const double* scores, int iteration);
+
+void pageRank(Graph g, double* solution, double damping, double convergence,
+              pr_stats* stats = NULL);
+// Warm start: iterate from initial (which may be solution) instead of
+// the uniform distribution.  after_iteration, if given, is called with
+// context after every iteration.
+void pageRankFrom(Graph g, double* solution, const double* initial, double damping,
+                  double convergence, pr_stats* stats = NULL,
+                  pr_iteration_fn after_iteration = NULL, void* context = NULL);
+// Scores saved for a later warm start.  Loading fails if the file is
+// missing, damaged or for a different number of vertices.
+bool store_scores(const char* filename, Graph g, const double* scores);
+bool load_scores(const char* filename, Graph g, double* scores);
+
+// Periodic checkpoints of a running pageRankFrom (page_rank_checkpoint.cpp).
+// Checkpoints are written every `every` iterations by a background
+// thread to prefix.0 and prefix.1 in turn; one that comes due while the
+// previous write is still going is skipped, so the computation never
+// waits for the disk.  Iterations are numbered from first_iteration,
+// the iteration a resumed run starts from, and the first write goes to
+// the slot after resumed_slot, the one it resumed from (slot 0 for a
+// fresh run).  Destroying waits for the write in flight and reports how
+// many were written and skipped.  checkpointer_offer is pageRankFrom's
+// after_iteration, with the checkpointer as context.
+struct pr_checkpointer;
+pr_checkpointer* checkpointer_create(const char* prefix, Graph g, int every,
+                                     int first_iteration = 0, int resumed_slot = -1);
+void checkpointer_offer(void* checkpointer, const double* scores, int iteration);
+void checkpointer_destroy(pr_checkpointer* checkpointer, int* written = NULL,
+                          int* skipped = NULL);
+// The newest checkpoint under prefix whose checksum matches and which
+// belongs to g, and the slot it is in; false if there is none
+bool load_checkpoint(const char* prefix, Graph g, double* scores, int* iteration,
+                     int* slot = NULL);
+
+// Push over outgoing edges with propagation blocking (page_rank_push.cpp)
+void pageRankPush(Graph g, double* solution, double damping, double convergence,
+                  pr_stats* stats = NULL);
+// Whether the graph's shape favors push over pull, and the variant
+// that follows that choice
+bool pageRankPrefersPush(Graph g);
+void pageRankAuto(Graph g, double* solution, double damping, double convergence,
+                  pr_stats* stats = NULL);
+
+// Residual propagation over active vertices only (page_rank_delta.cpp);
+// gaussSeidel updates the scores in place instead of by rounds
+void pageRankDelta(Graph g, double* solution, double damping, double convergence,
+                   bool gaussSeidel, pr_stats* stats = NULL);
+
+// An edge added to or removed from the graph
+struct pr_edge_change {
+    Vertex src;
+    Vertex dst;
+    bool added;
+};
+// Updates solution, the scores of the graph before changes, to those
+// of g, the graph after them, working outward from the changed edges.
+// Changes that reach much of the graph are handled by a warm restart
+// instead, and then the result is false.
+bool pageRankIncremental(Graph g, double* solution, const pr_edge_change* changes,
+                         int num_changes, double damping, double convergence,
+                         pr_stats* stats = NULL);
+
+// Float scores with double sums (page_rank_float.cpp): about 1e-7
+// relative accuracy for half the memory traffic
+void pageRankFloat(Graph g, double* solution, double damping, double convergence,
+                   pr_stats* stats = NULL);
+
+// Power iteration with Anderson mixing over the last `window` steps
+// (page_rank_anderson.cpp); converges to the same fixed point in far
+// fewer iterations at high damping
+void pageRankAnderson(Graph g, double* solution, int window, double damping,
+                      double convergence, pr_stats* stats = NULL);
+
+// Personalized PageRank (page_rank_personalized.cpp).  teleport is a
+// probability distribution over the vertices that replaces the uniform
+// jump; the batched form runs k of them together, with teleport and
+// solution stored num_nodes x k, row-major.
+void pageRankPersonalized(Graph g, double* solution, const double* teleport,
+                          double damping, double convergence, pr_stats* stats = NULL);
+void pageRankBatched(Graph g, double* solution, const double* teleport, int k,
+                     double damping, double convergence, pr_stats* stats = NULL);
+// Approximations for a single seed: local forward push, with L1 error
+// at most epsilon * num_edges, and the end points of random walks
+void pprForwardPush(Graph g, Vertex seed, double damping, double epsilon, double* solution);
+void pprMonteCarlo(Graph g, Vertex seed, double damping, long long walks,
+                   unsigned int rngSeed, double* solution);
 
 #endif /* __PAGE_RANK_H__ */
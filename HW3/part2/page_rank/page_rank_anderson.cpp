@@ -0,0 +1,224 @@
+#include "page_rank.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <cmath>
+#include <omp.h>
+#include <vector>
+
+#include "../common/graph.h"
+#include "../common/partition.h"
+#include "page_rank_gather.h"
+
+// Longest history kept, whatever window is asked for
+#define MAX_WINDOW 16
+// A pivot this small relative to the largest diagonal entry of the
+// normal equations means the history has become linearly dependent
+#define PIVOT_TOLERANCE 1e-12
+
+// Solves the h x h system a * x = b in place by elimination with
+// partial pivoting; false if a pivot is negligible
+static bool solve_small(double *a, double *b, int h)
+{
+  double scale = 0.0;
+  for (int i = 0; i < h; ++i)
+    scale = std::max(scale, fabs(a[i * h + i]));
+  for (int col = 0; col < h; ++col)
+  {
+    int pivot = col;
+    for (int row = col + 1; row < h; ++row)
+    {
+      if (fabs(a[row * h + col]) > fabs(a[pivot * h + col]))
+        pivot = row;
+    }
+    if (fabs(a[pivot * h + col]) <= PIVOT_TOLERANCE * scale)
+      return false;
+    if (pivot != col) {
+      for (int j = 0; j < h; ++j)
+        std::swap(a[col * h + j], a[pivot * h + j]);
+      std::swap(b[col], b[pivot]);
+    }
+    for (int row = col + 1; row < h; ++row)
+    {
+      double factor = a[row * h + col] / a[col * h + col];
+      for (int j = col; j < h; ++j)
+        a[row * h + j] -= factor * a[col * h + j];
+      b[row] -= factor * b[col];
+    }
+  }
+  for (int row = h - 1; row >= 0; --row)
+  {
+    double value = b[row];
+    for (int j = row + 1; j < h; ++j)
+      value -= a[row * h + j] * b[j];
+    b[row] = value / a[row * h + row];
+  }
+  return true;
+}
+
+// pageRankAnderson --
+//
+// pageRank's iteration x -> G(x) with Anderson mixing.  The last
+// `window` steps are remembered as differences of successive residuals
+// f = G(x) - x and of successive images G(x); the next iterate is G(x)
+// minus the combination of image differences whose residual
+// differences best cancel the current residual, in least squares.  On
+// this linear map that is close to GMRES, so the iteration count grows
+// much more slowly with damping than the power method's.
+//
+// The stopping rule is pageRank's, |G(x) - x| in L1, and the result is
+// the last G(x).  The mixed iterates take another path to the fixed
+// point than the power iterates, so the result is as close to the
+// fixed point as pageRank's, not to pageRank's result.  window 0 is
+// the plain power iteration.
+void pageRankAnderson(Graph g, double *solution, int window, double damping,
+                      double convergence, pr_stats *stats)
+{
+  int numNodes = num_nodes(g);
+  int m = std::min(std::max(window, 0), MAX_WINDOW);
+  double equalProb = 1.0 / numNodes;
+  // the scores are updated in place: the pull pass overwrites x with
+  // G(x), since it only reads the contributions, and the mixing pass
+  // overwrites G(x) with the next x
+  double *score = solution;
+  double *contrib = new double[numNodes];
+  // ring of the last m residual and image differences.  The slot the
+  // next step goes to is preloaded with -f and -G(x) of this step, so
+  // finishing it is an add and no previous f or G(x) is kept.
+  std::vector<double *> residualDiff(m), imageDiff(m);
+  for (int i = 0; i < m; ++i)
+  {
+    residualDiff[i] = new double[numNodes];
+    imageDiff[i] = new double[numNodes];
+  }
+  int parts = omp_get_max_threads() * PARTS_PER_THREAD;
+  std::vector<int> boundaries(parts + 1);
+  partition_vertices(g->incoming_starts, numNodes, g->num_edges, parts, boundaries.data());
+
+  #pragma omp parallel for
+  for (int i = 0; i < numNodes; ++i)
+  {
+    int degree = outgoing_degree(g, i);
+    score[i] = equalProb;
+    contrib[i] = (degree == 0) ? 0.0 : equalProb / degree;
+  }
+  double noOutgoingScore = g->num_dangling * equalProb;
+  double teleport = (1.0 - damping) / numNodes;
+
+  // gram[i][j] = residualDiff[i] . residualDiff[j] over the slots in use
+  double gram[MAX_WINDOW * MAX_WINDOW];
+  double system[MAX_WINDOW * MAX_WINDOW];
+  double gamma[MAX_WINDOW];
+  int used[MAX_WINDOW];
+  bool inUse[MAX_WINDOW] = {false};
+  int k = std::max(m, 1);
+  double *row = new double[k];
+  double *rhs = new double[k];
+  int slot = 0;
+  int iterations = 0;
+  bool converged = false;
+  while (!converged) {
+    // one pass applies G and finishes the step in slot: its residual
+    // difference, the products of that with the ones in use and the
+    // products of all of them with the new residual
+    bool record = m > 0 && iterations > 0;
+    int next = record ? (slot + 1) % m : slot;
+    if (record)
+      inUse[slot] = true;
+    double base = teleport + damping * noOutgoingScore / numNodes;
+    double globalDiff = 0.0;
+    for (int i = 0; i < k; ++i)
+    {
+      row[i] = 0.0;
+      rhs[i] = 0.0;
+    }
+    #pragma omp parallel for schedule(dynamic, 1) \
+      reduction(+: globalDiff) reduction(+: row[:k], rhs[:k])
+    for (int part = 0; part < parts; ++part)
+    {
+      for (int v = boundaries[part]; v < boundaries[part + 1]; ++v)
+      {
+        double image = damping * gather_contributions(incoming_begin(g, v),
+                                                      incoming_size(g, v), contrib) + base;
+        double residual = image - score[v];
+        score[v] = image;
+        globalDiff += fabs(residual);
+        if (record) {
+          double diff = residualDiff[slot][v] + residual;
+          residualDiff[slot][v] = diff;
+          imageDiff[slot][v] += image;
+          for (int i = 0; i < m; ++i)
+          {
+            if (inUse[i]) {
+              row[i] += diff * residualDiff[i][v];
+              rhs[i] += residualDiff[i][v] * residual;
+            }
+          }
+        }
+        // after the products, as next may be the oldest slot in use
+        if (m > 0)
+          residualDiff[next][v] = -residual;
+      }
+    }
+    iterations++;
+    converged = globalDiff < convergence;
+    if (converged)
+      break;
+
+    int h = 0;
+    if (record) {
+      for (int i = 0; i < m; ++i)
+      {
+        gram[slot * MAX_WINDOW + i] = row[i];
+        gram[i * MAX_WINDOW + slot] = row[i];
+        if (inUse[i])
+          used[h++] = i;
+      }
+      for (int i = 0; i < h; ++i)
+      {
+        for (int j = 0; j < h; ++j)
+          system[i * h + j] = gram[used[i] * MAX_WINDOW + used[j]];
+        gamma[i] = rhs[used[i]];
+      }
+      if (!solve_small(system, gamma, h)) {
+        // start over from a plain step rather than mix a degenerate history
+        for (int i = 0; i < m; ++i)
+          inUse[i] = false;
+        h = 0;
+      }
+      slot = next;
+    }
+
+    double nextNoOutgoingScore = 0.0;
+    #pragma omp parallel for reduction(+: nextNoOutgoingScore)
+    for (int v = 0; v < numNodes; ++v)
+    {
+      double image = score[v];
+      double mixed = image;
+      for (int i = 0; i < h; ++i)
+        mixed -= gamma[i] * imageDiff[used[i]][v];
+      if (m > 0)
+        imageDiff[slot][v] = -image;
+      int degree = outgoing_degree(g, v);
+      score[v] = mixed;
+      contrib[v] = (degree == 0) ? 0.0 : mixed / degree;
+      if (degree == 0)
+        nextNoOutgoingScore += mixed;
+    }
+    noOutgoingScore = nextNoOutgoingScore;
+  }
+
+  if (stats) {
+    stats->iterations = iterations;
+    stats->edges = (long long)iterations * g->num_edges;
+  }
+  for (int i = 0; i < m; ++i)
+  {
+    delete[] residualDiff[i];
+    delete[] imageDiff[i];
+  }
+  delete[] contrib;
+  delete[] row;
+  delete[] rhs;
+}
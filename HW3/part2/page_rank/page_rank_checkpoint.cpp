@@ -0,0 +1,231 @@
+#include "page_rank.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../common/graph.h"
+
+// First word of a checkpoint file; the rest of the header is the
+// vertex and edge counts, the iteration and the checksum, then come
+// the scores
+#define CHECKPOINT_HEADER_TOKEN 0xC4EC4B01
+// Checkpoints alternate between this many files, so a crash while one
+// is written leaves the previous one intact
+#define CHECKPOINT_SLOTS 2
+
+struct checkpoint_header {
+  int token;
+  int num_nodes;
+  int num_edges;
+  int iteration;
+  uint64_t checksum;
+};
+
+// FNV-1a over the iteration and the score bytes
+static uint64_t checkpoint_checksum(int iteration, const double *scores, int count)
+{
+  uint64_t hash = 14695981039346656037ULL;
+  const unsigned char *bytes = (const unsigned char *)&iteration;
+  for (size_t i = 0; i < sizeof(iteration); ++i)
+    hash = (hash ^ bytes[i]) * 1099511628211ULL;
+  bytes = (const unsigned char *)scores;
+  for (size_t i = 0; i < sizeof(double) * count; ++i)
+    hash = (hash ^ bytes[i]) * 1099511628211ULL;
+  return hash;
+}
+
+static std::string slot_filename(const std::string &prefix, int slot)
+{
+  return prefix + "." + std::to_string(slot);
+}
+
+// A snapshot is copied into buffer by the computing thread and written
+// out by writer while the computation moves on.  Only one snapshot is
+// in flight: if the writer is still busy when the next one is due,
+// that one is skipped rather than waited for.
+struct pr_checkpointer {
+  std::string prefix;
+  int num_nodes;
+  int num_edges;
+  int every;
+  int first_iteration;
+  double *buffer;
+  int buffer_iteration;
+  int slot;
+  bool busy;
+  bool stop;
+  int written;
+  int skipped;
+  std::mutex lock;
+  std::condition_variable wake;
+  std::thread writer;
+};
+
+static bool write_checkpoint(pr_checkpointer *cp)
+{
+  checkpoint_header header;
+  header.token = (int)CHECKPOINT_HEADER_TOKEN;
+  header.num_nodes = cp->num_nodes;
+  header.num_edges = cp->num_edges;
+  header.iteration = cp->buffer_iteration;
+  header.checksum = checkpoint_checksum(cp->buffer_iteration, cp->buffer, cp->num_nodes);
+
+  // written under a temporary name of its own and renamed over the
+  // slot, so the slot always holds a whole checkpoint, even with other
+  // runs checkpointing the same graph
+  std::string temporary = cp->prefix + ".tmp.XXXXXX";
+  int fd = mkstemp(&temporary[0]);
+  if (fd < 0)
+    return false;
+  FILE *file = fdopen(fd, "wb");
+  if (!file) {
+    close(fd);
+    unlink(temporary.c_str());
+    return false;
+  }
+  bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+            fwrite(cp->buffer, sizeof(double), cp->num_nodes, file) == (size_t)cp->num_nodes &&
+            fflush(file) == 0 && fsync(fileno(file)) == 0;
+  ok = fclose(file) == 0 && ok;
+  ok = ok && rename(temporary.c_str(), slot_filename(cp->prefix, cp->slot).c_str()) == 0;
+  if (!ok)
+    unlink(temporary.c_str());
+  return ok;
+}
+
+static void writer_loop(pr_checkpointer *cp)
+{
+  std::unique_lock<std::mutex> guard(cp->lock);
+  while (true) {
+    cp->wake.wait(guard, [cp] { return cp->busy || cp->stop; });
+    if (!cp->busy)
+      return;
+    guard.unlock();
+    bool ok = write_checkpoint(cp);
+    guard.lock();
+    if (ok) {
+      cp->slot = (cp->slot + 1) % CHECKPOINT_SLOTS;
+      cp->written++;
+    } else {
+      fprintf(stderr, "Could not write checkpoint %s\n",
+              slot_filename(cp->prefix, cp->slot).c_str());
+    }
+    cp->busy = false;
+  }
+}
+
+// Reads one slot into scores; false unless it is a whole checkpoint of
+// g whose checksum matches
+static bool read_checkpoint(const std::string &filename, Graph g, double *scores,
+                            int *iteration)
+{
+  FILE *file = fopen(filename.c_str(), "rb");
+  if (!file)
+    return false;
+  checkpoint_header header;
+  bool ok = fread(&header, sizeof(header), 1, file) == 1 &&
+            header.token == (int)CHECKPOINT_HEADER_TOKEN &&
+            header.num_nodes == g->num_nodes && header.num_edges == g->num_edges &&
+            fread(scores, sizeof(double), g->num_nodes, file) == (size_t)g->num_nodes &&
+            header.checksum == checkpoint_checksum(header.iteration, scores, g->num_nodes);
+  fclose(file);
+  if (ok)
+    *iteration = header.iteration;
+  return ok;
+}
+
+// The slot holding the newest valid checkpoint, read into scores, or -1
+static int newest_checkpoint(const std::string &prefix, Graph g, double *scores,
+                             int *iteration)
+{
+  std::vector<double> candidate(g->num_nodes);
+  int newest = -1;
+  for (int slot = 0; slot < CHECKPOINT_SLOTS; ++slot)
+  {
+    int candidateIteration;
+    if (read_checkpoint(slot_filename(prefix, slot), g, candidate.data(), &candidateIteration) &&
+        (newest < 0 || candidateIteration > *iteration)) {
+      newest = slot;
+      *iteration = candidateIteration;
+      memcpy(scores, candidate.data(), sizeof(double) * g->num_nodes);
+    }
+  }
+  return newest;
+}
+
+pr_checkpointer *checkpointer_create(const char *prefix, Graph g, int every, int first_iteration,
+                                     int resumed_slot)
+{
+  pr_checkpointer *cp = new pr_checkpointer;
+  cp->prefix = prefix;
+  cp->num_nodes = g->num_nodes;
+  cp->num_edges = g->num_edges;
+  cp->every = every > 0 ? every : 1;
+  cp->first_iteration = first_iteration;
+  cp->buffer = new double[g->num_nodes];
+  cp->buffer_iteration = 0;
+  // the first write never replaces the checkpoint a run resumed from
+  cp->slot = resumed_slot >= 0 ? (resumed_slot + 1) % CHECKPOINT_SLOTS : 0;
+  cp->busy = false;
+  cp->stop = false;
+  cp->written = 0;
+  cp->skipped = 0;
+  cp->writer = std::thread(writer_loop, cp);
+  return cp;
+}
+
+void checkpointer_destroy(pr_checkpointer *cp, int *written, int *skipped)
+{
+  {
+    std::lock_guard<std::mutex> guard(cp->lock);
+    cp->stop = true;
+  }
+  cp->wake.notify_one();
+  cp->writer.join();
+  if (written)
+    *written = cp->written;
+  if (skipped)
+    *skipped = cp->skipped;
+  delete[] cp->buffer;
+  delete cp;
+}
+
+void checkpointer_offer(void *checkpointer, const double *scores, int iteration)
+{
+  pr_checkpointer *cp = (pr_checkpointer *)checkpointer;
+  if (iteration % cp->every != 0)
+    return;
+  {
+    std::lock_guard<std::mutex> guard(cp->lock);
+    if (cp->busy) {
+      cp->skipped++;
+      return;
+    }
+  }
+  // the writer only touches the buffer while busy, so it is ours now
+  #pragma omp parallel for
+  for (int i = 0; i < cp->num_nodes; ++i)
+    cp->buffer[i] = scores[i];
+  {
+    std::lock_guard<std::mutex> guard(cp->lock);
+    cp->buffer_iteration = cp->first_iteration + iteration;
+    cp->busy = true;
+  }
+  cp->wake.notify_one();
+}
+
+bool load_checkpoint(const char *prefix, Graph g, double *scores, int *iteration, int *slot)
+{
+  int newest = newest_checkpoint(prefix, g, scores, iteration);
+  if (slot)
+    *slot = newest;
+  return newest >= 0;
+}
@@ -0,0 +1,514 @@
+#include "page_rank.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <cmath>
+#include <omp.h>
+#include <vector>
+
+#include "../common/graph.h"
+#include "../common/partition.h"
+#include "page_rank_gather.h"
+
+// A vertex propagates its pending change once that exceeds convergence
+// times this factor divided by num_nodes; smaller changes wait until
+// later ones add up past it.
+#define DELTA_THRESHOLD_FACTOR 1e-1
+// Per-thread buffer for the next round's candidates
+#define LOCAL_BUFFER 256
+// Rounds whose active vertices have more than 1/DENSE_DIVISOR of the
+// edges pull over all incoming edges instead, which needs no atomics
+#define DENSE_DIVISOR 16
+// Changes whose affected vertices have more than 1/INCREMENTAL_DIVISOR
+// of the incoming edges are absorbed by a warm restart instead
+#define INCREMENTAL_DIVISOR 16
+
+static inline void atomic_add(double *target, double value)
+{
+  double old = *target, updated;
+  do {
+    updated = old + value;
+  } while (!__atomic_compare_exchange(target, &old, &updated, true,
+                                      __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+}
+
+// Appends to frontier, from position *size on, the candidates whose
+// pending change exceeds the threshold.  candidates NULL means every
+// vertex; then each first takes the uniform change, if any.
+static void collect_frontier(const Vertex *candidates, int count, double *pending,
+                             double uniform, double threshold, std::vector<Vertex> &frontier,
+                             int *size)
+{
+  #pragma omp parallel
+  {
+    Vertex local[LOCAL_BUFFER];
+    int localCount = 0;
+    #pragma omp for schedule(static) nowait
+    for (int i = 0; i < count; ++i)
+    {
+      Vertex v = candidates ? candidates[i] : i;
+      if (!candidates)
+        pending[v] += uniform;
+      if (fabs(pending[v]) > threshold) {
+        local[localCount++] = v;
+        if (localCount == LOCAL_BUFFER) {
+          int index = __sync_fetch_and_add(size, localCount);
+          memcpy(&frontier[index], local, sizeof(Vertex) * localCount);
+          localCount = 0;
+        }
+      }
+    }
+    int index = __sync_fetch_and_add(size, localCount);
+    memcpy(&frontier[index], local, sizeof(Vertex) * localCount);
+  }
+}
+
+// delta_jacobi --
+//
+// The Jacobi iteration of pageRank, carried by the change in score
+// instead of the score: x(k+1) - x(k) = damping P (x(k) - x(k-1)), so
+// a round only has to pass on each vertex's latest change.  Changes
+// below the threshold are not passed on but kept pending, so vertices
+// that have settled cost nothing until enough change reaches them
+// again.  Vertices without outgoing edges spread their change evenly,
+// which is kept as one uniform change for all vertices and passed on
+// once it matters.  Sparse rounds push along the outgoing edges of the
+// active vertices; dense rounds pull, like bfs_hybrid.  Stops under
+// the same rule as pageRank: the L1 change of a round is below
+// convergence.
+//
+// On entry score holds the current scores, pending the change still to
+// be passed on (zero outside frontier) and nextUniform a change every
+// vertex takes in the first round.  Without spreadDangling the change
+// reaching vertices without outgoing edges goes nowhere.
+static void delta_jacobi(Graph g, double *score, double *pending, std::vector<Vertex> &frontier,
+                         double nextUniform, bool spreadDangling, double damping,
+                         double convergence, double threshold, pr_stats *stats)
+{
+  int numNodes = num_nodes(g);
+  // change received this round
+  double *received = new double[numNodes];
+  // what each active vertex passes along an edge in a dense round
+  double *outgoing = new double[numNodes];
+  // set while a vertex is on the candidate list
+  char *queued = new char[numNodes];
+  std::vector<Vertex> touched(numNodes);
+  int frontierSize = frontier.size();
+  frontier.resize(numNodes);
+  int parts = omp_get_max_threads() * PARTS_PER_THREAD;
+  std::vector<int> boundaries(parts + 1);
+  partition_vertices(g->incoming_starts, numNodes, g->num_edges, parts, boundaries.data());
+
+  #pragma omp parallel for
+  for (int i = 0; i < numNodes; ++i)
+  {
+    received[i] = 0.0;
+    queued[i] = 0;
+  }
+  // change every vertex holds in addition to score[] and pending[]
+  double uniformScore = 0.0;
+  double uniformPending = 0.0;
+  int iterations = 0;
+  long long edges = 0;
+
+  bool converged = false;
+  while (!converged) {
+    int touchedSize = 0;
+    double spread = nextUniform;
+    long long roundEdges = 0;
+    long long activeEdges = 0;
+    #pragma omp parallel for reduction(+: activeEdges)
+    for (int i = 0; i < frontierSize; ++i)
+      activeEdges += outgoing_size(g, frontier[i]);
+    bool dense = activeEdges > g->num_edges / DENSE_DIVISOR;
+
+    if (dense) {
+      // every vertex gathers what its active in-neighbors pass on
+      #pragma omp parallel for
+      for (int i = 0; i < numNodes; ++i)
+        outgoing[i] = 0.0;
+      #pragma omp parallel for reduction(+: spread)
+      for (int i = 0; i < frontierSize; ++i)
+      {
+        Vertex u = frontier[i];
+        int degree = outgoing_degree(g, u);
+        if (degree == 0 && spreadDangling)
+          spread += damping * pending[u] / numNodes;
+        else if (degree != 0)
+          outgoing[u] = damping * pending[u] / degree;
+        pending[u] = 0.0;
+      }
+      #pragma omp parallel for schedule(dynamic, 1)
+      for (int part = 0; part < parts; ++part)
+      {
+        for (int v = boundaries[part]; v < boundaries[part + 1]; ++v)
+        {
+          received[v] = gather_contributions(incoming_begin(g, v), incoming_size(g, v), outgoing);
+          touched[v] = v;
+        }
+      }
+      roundEdges = g->num_edges;
+      touchedSize = numNodes;
+    } else {
+      #pragma omp parallel reduction(+: spread, roundEdges)
+      {
+        Vertex local[LOCAL_BUFFER];
+        int localCount = 0;
+        #pragma omp for schedule(dynamic, 64)
+        for (int i = 0; i < frontierSize; ++i)
+        {
+          Vertex u = frontier[i];
+          double change = pending[u];
+          pending[u] = 0.0;
+          int degree = outgoing_degree(g, u);
+          if (degree == 0) {
+            if (spreadDangling)
+              spread += damping * change / numNodes;
+            continue;
+          }
+          double push = damping * change / degree;
+          roundEdges += degree;
+          for (const Vertex *v = outgoing_begin(g, u); v != outgoing_end(g, u); ++v)
+          {
+            atomic_add(&received[*v], push);
+            if (!queued[*v] && __sync_bool_compare_and_swap(&queued[*v], 0, 1)) {
+              local[localCount++] = *v;
+              if (localCount == LOCAL_BUFFER) {
+                int index = __sync_fetch_and_add(&touchedSize, localCount);
+                memcpy(&touched[index], local, sizeof(Vertex) * localCount);
+                localCount = 0;
+              }
+            }
+          }
+        }
+        int index = __sync_fetch_and_add(&touchedSize, localCount);
+        memcpy(&touched[index], local, sizeof(Vertex) * localCount);
+      }
+    }
+    iterations++;
+    edges += roundEdges;
+    nextUniform = 0.0;
+    uniformScore += spread;
+    uniformPending += spread;
+
+    // settle the round's changes; the vertices nobody pushed to only
+    // changed by the uniform spread
+    double globalDiff = (double)(numNodes - touchedSize) * fabs(spread);
+    #pragma omp parallel for reduction(+: globalDiff)
+    for (int i = 0; i < touchedSize; ++i)
+    {
+      Vertex v = touched[i];
+      double change = received[v];
+      received[v] = 0.0;
+      score[v] += change;
+      pending[v] += change;
+      globalDiff += fabs(change + spread);
+      queued[v] = 0;
+    }
+    converged = globalDiff < convergence;
+
+    // only vertices whose pending change grew can have become active,
+    // unless the round was dense or the uniform change is due everywhere
+    frontierSize = 0;
+    if (dense || fabs(uniformPending) > threshold) {
+      collect_frontier(NULL, numNodes, pending, uniformPending, threshold, frontier,
+                       &frontierSize);
+      uniformPending = 0.0;
+    } else {
+      collect_frontier(touched.data(), touchedSize, pending, 0.0, threshold, frontier,
+                       &frontierSize);
+    }
+    converged = converged || frontierSize == 0;
+  }
+
+  #pragma omp parallel for
+  for (int i = 0; i < numNodes; ++i)
+    score[i] += uniformScore;
+
+  if (stats) {
+    stats->iterations = iterations;
+    stats->edges = edges;
+  }
+  delete[] received;
+  delete[] outgoing;
+  delete[] queued;
+}
+
+// gauss_seidel --
+//
+// In-place pull: each active vertex recomputes its score from the
+// current contributions of its in-neighbors, including the ones
+// updated earlier in the same round, and publishes its own right away.
+// A vertex is active when one of its in-neighbors changed by more than
+// the threshold since it was last computed.  The dangling score is
+// refreshed once per round; if that moves every score by more than the
+// threshold, every vertex is recomputed.
+//
+// The L1 change of a round understates how far in-place scores are
+// from the fixed point (a hub computed early in the round lags behind
+// all its in-neighbors), so this stops once no vertex is active rather
+// than on pageRank's convergence test.
+//
+// Threads read contributions other threads are writing in the same
+// round, so contrib[] is only accessed with relaxed atomic loads and
+// stores; which of the two values a reader sees does not matter.
+static void gauss_seidel(Graph g, double *solution, double damping, double threshold,
+                         pr_stats *stats)
+{
+  int numNodes = num_nodes(g);
+  double equalProb = 1.0 / numNodes;
+  double *score = solution;
+  double *contrib = new double[numNodes];
+  char *active = new char[numNodes];
+  #pragma omp parallel for
+  for (int i = 0; i < numNodes; ++i)
+  {
+    int degree = outgoing_degree(g, i);
+    score[i] = equalProb;
+    contrib[i] = (degree == 0) ? 0.0 : equalProb / degree;
+    active[i] = 1;
+  }
+  double noOutgoingScore = g->num_dangling * equalProb;
+  double teleport = (1.0 - damping) / numNodes;
+  int parts = omp_get_max_threads() * PARTS_PER_THREAD;
+  std::vector<int> boundaries(parts + 1);
+  partition_vertices(g->incoming_starts, numNodes, g->num_edges, parts, boundaries.data());
+  int iterations = 0;
+  long long edges = 0;
+
+  bool converged = false;
+  while (!converged) {
+    double base = teleport + damping * noOutgoingScore / numNodes;
+    double noOutgoingChange = 0.0;
+    long long roundEdges = 0;
+    int marked = 0;
+    #pragma omp parallel for schedule(dynamic, 1) \
+      reduction(+: noOutgoingChange, roundEdges, marked)
+    for (int part = 0; part < parts; ++part)
+    {
+      for (int v = boundaries[part]; v < boundaries[part + 1]; ++v)
+      {
+        // taking the flag before reading the contributions means a mark
+        // set after this point is kept for the next round
+        if (!__atomic_exchange_n(&active[v], 0, __ATOMIC_ACQ_REL))
+          continue;
+        double sum = 0.0;
+        for (const Vertex *u = incoming_begin(g, v); u != incoming_end(g, v); ++u)
+        {
+          double value;
+          __atomic_load(&contrib[*u], &value, __ATOMIC_RELAXED);
+          sum += value;
+        }
+        roundEdges += incoming_size(g, v);
+        double updated = damping * sum + base;
+        // score[v] is only touched by the thread that took v's flag
+        double change = updated - score[v];
+        int degree = outgoing_degree(g, v);
+        score[v] = updated;
+        if (degree == 0) {
+          noOutgoingChange += change;
+          continue;
+        }
+        double published = updated / degree;
+        __atomic_store(&contrib[v], &published, __ATOMIC_RELAXED);
+        if (fabs(change) > threshold) {
+          marked++;
+          for (const Vertex *w = outgoing_begin(g, v); w != outgoing_end(g, v); ++w)
+            __atomic_store_n(&active[*w], 1, __ATOMIC_RELEASE);
+        }
+      }
+    }
+    iterations++;
+    edges += roundEdges;
+    noOutgoingScore += noOutgoingChange;
+    converged = marked == 0;
+
+    if (fabs(damping * noOutgoingChange / numNodes) > threshold) {
+      converged = false;
+      #pragma omp parallel for
+      for (int i = 0; i < numNodes; ++i)
+        active[i] = 1;
+    }
+  }
+
+  if (stats) {
+    stats->iterations = iterations;
+    stats->edges = edges;
+  }
+  delete[] contrib;
+  delete[] active;
+}
+
+// pageRankDelta --
+//
+// PageRank that only spends work on the vertices whose score is still
+// moving: a vertex is left alone until its in-neighbors have changed by
+// more than convergence * DELTA_THRESHOLD_FACTOR / num_nodes.
+//
+// Without gaussSeidel the result follows the Jacobi iterates of
+// pageRank and stops at the same iteration.  That only saves work where
+// parts of the graph settle early, as on grids: a vertex's change
+// shrinks by about damping per round, so on a graph that mixes fast,
+// like rmat, every vertex stays above the threshold until pageRank's
+// L1 test stops both, every round is dense and the edge work is the
+// same as pageRank's.  With gaussSeidel scores
+// are updated in place and it runs until no vertex is active, which
+// lands closer to the fixed point than pageRank's last iterate.
+void pageRankDelta(Graph g, double *solution, double damping, double convergence,
+                   bool gaussSeidel, pr_stats *stats)
+{
+  double threshold = convergence * DELTA_THRESHOLD_FACTOR / num_nodes(g);
+  if (gaussSeidel) {
+    gauss_seidel(g, solution, damping, threshold, stats);
+    return;
+  }
+
+  // x(0) is uniform, so the first round passes on all of it, and the
+  // teleport term replaces x(0) in every vertex
+  int numNodes = num_nodes(g);
+  double equalProb = 1.0 / numNodes;
+  double *pending = new double[numNodes];
+  std::vector<Vertex> frontier(numNodes);
+  #pragma omp parallel for
+  for (int i = 0; i < numNodes; ++i)
+  {
+    solution[i] = equalProb;
+    pending[i] = equalProb;
+    frontier[i] = i;
+  }
+  delta_jacobi(g, solution, pending, frontier, (1.0 - damping) / numNodes - equalProb,
+               true, damping, convergence, threshold, stats);
+  delete[] pending;
+}
+
+// pageRankIncremental --
+//
+// The scores in solution were computed for the graph before changes
+// were applied to it; g is the graph after.  Every term that spreads
+// evenly over all vertices (teleport and dangling score) only scales
+// the result, so PageRank is (I - damping P)^-1 applied to a uniform
+// vector, normalized to sum to 1, where P leaves out the vertices
+// without outgoing edges.  The old scores solve that system for the
+// old P with the old uniform term, so against the new P their residual
+// is zero except where an incoming edge changed or an in-neighbor's
+// degree did.  Only those residuals are computed; delta_jacobi passes
+// them on without spreading anything evenly, and the result is
+// normalized at the end.
+//
+// The residuals left over from the previous run are not recomputed;
+// they are below what its convergence test allowed, so the result is
+// as close to the fixed point as a cold start.
+//
+// This only pays while the changes stay local.  On fast-mixing graphs
+// like rmat a 1% change already reaches nearly every edge, and passing
+// on changes costs more per edge than pageRank's pull; past the
+// INCREMENTAL_DIVISOR limit the run is a warm start from solution, and
+// the result false.
+bool pageRankIncremental(Graph g, double *solution, const pr_edge_change *changes,
+                         int num_changes, double damping, double convergence,
+                         pr_stats *stats)
+{
+  int numNodes = num_nodes(g);
+  double threshold = convergence * DELTA_THRESHOLD_FACTOR / numNodes;
+  double *pending = new double[numNodes];
+  int *degreeChange = new int[numNodes];
+  char *affected = new char[numNodes];
+  #pragma omp parallel for
+  for (int i = 0; i < numNodes; ++i)
+  {
+    pending[i] = 0.0;
+    degreeChange[i] = 0;
+    affected[i] = 0;
+  }
+
+  std::vector<Vertex> sources;
+  std::vector<Vertex> targets;
+  for (int c = 0; c < num_changes; ++c)
+  {
+    Vertex src = changes[c].src;
+    if (!affected[changes[c].dst]) {
+      affected[changes[c].dst] = 1;
+      targets.push_back(changes[c].dst);
+    }
+    sources.push_back(src);
+    degreeChange[src] += changes[c].added ? 1 : -1;
+  }
+  std::sort(sources.begin(), sources.end());
+  sources.erase(std::unique(sources.begin(), sources.end()), sources.end());
+  // the old dangling score, from the new dangling list and the sources
+  // whose degree crossed zero
+  double oldNoOutgoingScore = 0.0;
+  for (int i = 0; i < g->num_dangling; ++i)
+    oldNoOutgoingScore += solution[g->dangling_vertices[i]];
+  for (Vertex src : sources)
+  {
+    if (degreeChange[src] == 0)
+      continue;
+    int degree = outgoing_degree(g, src);
+    int oldDegree = degree - degreeChange[src];
+    if (degree == 0 && oldDegree != 0)
+      oldNoOutgoingScore -= solution[src];
+    if (degree != 0 && oldDegree == 0)
+      oldNoOutgoingScore += solution[src];
+    for (const Vertex *v = outgoing_begin(g, src); v != outgoing_end(g, src); ++v)
+    {
+      if (!affected[*v]) {
+        affected[*v] = 1;
+        targets.push_back(*v);
+      }
+    }
+  }
+  long long reached = 0;
+  for (Vertex v : targets)
+    reached += incoming_size(g, v);
+  if (reached * INCREMENTAL_DIVISOR > g->num_edges) {
+    delete[] pending;
+    delete[] degreeChange;
+    delete[] affected;
+    pageRankFrom(g, solution, solution, damping, convergence, stats);
+    return false;
+  }
+  // the uniform term the old scores were a fixed point for
+  double base = (1.0 - damping) / numNodes + damping * oldNoOutgoingScore / numNodes;
+
+  // residuals first, then the scores, since they read each other
+  int numTargets = targets.size();
+  long long edges = 0;
+  #pragma omp parallel for schedule(dynamic, 64) reduction(+: edges)
+  for (int i = 0; i < numTargets; ++i)
+  {
+    Vertex v = targets[i];
+    double sum = 0.0;
+    for (const Vertex *u = incoming_begin(g, v); u != incoming_end(g, v); ++u)
+      sum += solution[*u] / outgoing_degree(g, *u);
+    edges += incoming_size(g, v);
+    pending[v] = damping * sum + base - solution[v];
+  }
+  std::vector<Vertex> frontier;
+  for (Vertex v : targets)
+  {
+    solution[v] += pending[v];
+    if (fabs(pending[v]) > threshold)
+      frontier.push_back(v);
+  }
+
+  delta_jacobi(g, solution, pending, frontier, 0.0, false, damping, convergence, threshold,
+               stats);
+  double total = 0.0;
+  #pragma omp parallel for reduction(+: total)
+  for (int i = 0; i < numNodes; ++i)
+    total += solution[i];
+  #pragma omp parallel for
+  for (int i = 0; i < numNodes; ++i)
+    solution[i] /= total;
+
+  if (stats) {
+    stats->iterations++;
+    stats->edges += edges;
+  }
+  delete[] pending;
+  delete[] degreeChange;
+  delete[] affected;
+  return true;
+}
@@ -0,0 +1,132 @@
+#include "page_rank.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <cmath>
+#include <omp.h>
+#include <utility>
+#include <vector>
+
+#include "../common/graph.h"
+#include "../common/partition.h"
+#include "page_rank_gather.h"
+
+// Sum of the float contributions of one vertex's incoming neighbors,
+// accumulated in double.  The AVX2 version gathers four floats at a
+// time and widens them into two double accumulators.
+typedef double (*gather_float_fn)(const Vertex *neighbors, int count, const float *contrib);
+
+static double gather_float_scalar(const Vertex *neighbors, int count, const float *contrib)
+{
+  double sum = 0.0;
+  for (int i = 0; i < count; ++i)
+    sum += contrib[neighbors[i]];
+  return sum;
+}
+
+#ifdef HAVE_X86_SIMD
+__attribute__((target("avx2")))
+static double gather_float_avx2(const Vertex *neighbors, int count, const float *contrib)
+{
+  __m256d sum0 = _mm256_setzero_pd();
+  __m256d sum1 = _mm256_setzero_pd();
+  int i = 0;
+  for (; i + 8 <= count; i += 8)
+  {
+    __m128i index0 = _mm_loadu_si128((const __m128i *)(neighbors + i));
+    __m128i index1 = _mm_loadu_si128((const __m128i *)(neighbors + i + 4));
+    sum0 = _mm256_add_pd(sum0, _mm256_cvtps_pd(_mm_i32gather_ps(contrib, index0, 4)));
+    sum1 = _mm256_add_pd(sum1, _mm256_cvtps_pd(_mm_i32gather_ps(contrib, index1, 4)));
+  }
+  __m256d both = _mm256_add_pd(sum0, sum1);
+  __m128d half = _mm_add_pd(_mm256_castpd256_pd128(both), _mm256_extractf128_pd(both, 1));
+  double sum = _mm_cvtsd_f64(_mm_add_sd(half, _mm_unpackhi_pd(half, half)));
+  for (; i < count; ++i)
+    sum += contrib[neighbors[i]];
+  return sum;
+}
+#endif
+
+static gather_float_fn select_gather_float()
+{
+#ifdef HAVE_X86_SIMD
+  if (gather_use_avx2())
+    return gather_float_avx2;
+#endif
+  return gather_float_scalar;
+}
+
+static const gather_float_fn gather_float = select_gather_float();
+
+// pageRankFloat --
+//
+// pageRank with the scores and contributions stored as float, which
+// halves the bytes the pull loop streams and gathers.  Everything that
+// adds many terms stays in double: the per-vertex sums, the change
+// that decides convergence and the dangling score.  The scores are
+// widened into solution at the end.
+void pageRankFloat(Graph g, double *solution, double damping, double convergence,
+                   pr_stats *stats)
+{
+  int numNodes = num_nodes(g);
+  double equalProb = 1.0 / numNodes;
+  float *scoreOld = new float[numNodes];
+  float *scoreNew = new float[numNodes];
+  float *contribOld = new float[numNodes];
+  float *contribNew = new float[numNodes];
+  int parts = omp_get_max_threads() * PARTS_PER_THREAD;
+  std::vector<int> boundaries(parts + 1);
+  partition_vertices(g->incoming_starts, numNodes, g->num_edges, parts, boundaries.data());
+
+  #pragma omp parallel for
+  for (int i = 0; i < numNodes; ++i)
+  {
+    int degree = outgoing_degree(g, i);
+    scoreOld[i] = (float)equalProb;
+    contribOld[i] = (degree == 0) ? 0.0f : (float)(equalProb / degree);
+  }
+  double noOutgoingScore = g->num_dangling * equalProb;
+  double teleport = (1.0 - damping) / numNodes;
+  int iterations = 0;
+  bool converged = false;
+  while (!converged) {
+    double base = teleport + damping * noOutgoingScore / numNodes;
+    double globalDiff = 0.0;
+    double nextNoOutgoingScore = 0.0;
+    #pragma omp parallel for schedule(dynamic, 1) \
+      reduction(+: globalDiff, nextNoOutgoingScore)
+    for (int part = 0; part < parts; ++part)
+    {
+      for (int cur = boundaries[part]; cur < boundaries[part + 1]; ++cur)
+      {
+        double sum = gather_float(incoming_begin(g, cur), incoming_size(g, cur), contribOld);
+        double score = damping * sum + base;
+        int degree = outgoing_degree(g, cur);
+        scoreNew[cur] = (float)score;
+        contribNew[cur] = (degree == 0) ? 0.0f : (float)(score / degree);
+        // compared as stored, so the change reaches 0 once the float
+        // scores stop moving instead of stalling at rounding noise
+        globalDiff += fabs((double)scoreNew[cur] - scoreOld[cur]);
+        if (degree == 0)
+          nextNoOutgoingScore += score;
+      }
+    }
+    std::swap(scoreOld, scoreNew);
+    std::swap(contribOld, contribNew);
+    noOutgoingScore = nextNoOutgoingScore;
+    converged = globalDiff < convergence;
+    iterations++;
+  }
+
+  #pragma omp parallel for
+  for (int i = 0; i < numNodes; ++i)
+    solution[i] = scoreOld[i];
+  if (stats) {
+    stats->iterations = iterations;
+    stats->edges = (long long)iterations * g->num_edges;
+  }
+  delete[] scoreOld;
+  delete[] scoreNew;
+  delete[] contribOld;
+  delete[] contribNew;
+}
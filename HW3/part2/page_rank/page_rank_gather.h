@@ -0,0 +1,83 @@
+#ifndef __PAGE_RANK_GATHER_H__
+#define __PAGE_RANK_GATHER_H__
+
+/*
+ * Pieces shared by the pull loops of the PageRank variants: the work
+ * split, the gather-sum over a vertex's incoming neighbors and the
+ * choice between its scalar and AVX2 kernels.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86_SIMD 1
+#endif
+
+#include "../common/graph.h"
+
+// The pull loop splits the vertices into this many edge-balanced parts
+// per thread, handed out dynamically.
+#define PARTS_PER_THREAD 4
+
+// Whether the AVX2 kernels are used: the CPU must have AVX2, and
+// PR_GATHER=scalar in the environment turns them off everywhere
+static inline bool gather_use_avx2()
+{
+#ifdef HAVE_X86_SIMD
+  const char *forced = getenv("PR_GATHER");
+  __builtin_cpu_init();
+  return !(forced && !strcmp(forced, "scalar")) && __builtin_cpu_supports("avx2");
+#else
+  return false;
+#endif
+}
+
+// Sum of contrib[] over one vertex's incoming neighbors.  The AVX2
+// version gathers four contributions at a time into two accumulators,
+// so it adds in a different order than the scalar loop.
+typedef double (*gather_fn)(const Vertex *neighbors, int count, const double *contrib);
+
+static inline double gather_scalar(const Vertex *neighbors, int count, const double *contrib)
+{
+  double sum = 0.0;
+  for (int i = 0; i < count; ++i)
+    sum += contrib[neighbors[i]];
+  return sum;
+}
+
+#ifdef HAVE_X86_SIMD
+__attribute__((target("avx2")))
+static inline double gather_avx2(const Vertex *neighbors, int count, const double *contrib)
+{
+  __m256d sum0 = _mm256_setzero_pd();
+  __m256d sum1 = _mm256_setzero_pd();
+  int i = 0;
+  for (; i + 8 <= count; i += 8)
+  {
+    __m128i index0 = _mm_loadu_si128((const __m128i *)(neighbors + i));
+    __m128i index1 = _mm_loadu_si128((const __m128i *)(neighbors + i + 4));
+    sum0 = _mm256_add_pd(sum0, _mm256_i32gather_pd(contrib, index0, 8));
+    sum1 = _mm256_add_pd(sum1, _mm256_i32gather_pd(contrib, index1, 8));
+  }
+  __m256d both = _mm256_add_pd(sum0, sum1);
+  __m128d half = _mm_add_pd(_mm256_castpd256_pd128(both), _mm256_extractf128_pd(both, 1));
+  double sum = _mm_cvtsd_f64(_mm_add_sd(half, _mm_unpackhi_pd(half, half)));
+  for (; i < count; ++i)
+    sum += contrib[neighbors[i]];
+  return sum;
+}
+#endif
+
+static inline gather_fn select_gather()
+{
+#ifdef HAVE_X86_SIMD
+  if (gather_use_avx2())
+    return gather_avx2;
+#endif
+  return gather_scalar;
+}
+
+static const gather_fn gather_contributions = select_gather();
+
+#endif /* __PAGE_RANK_GATHER_H__ */
@@ -0,0 +1,299 @@
+#include "page_rank.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <cmath>
+#include <omp.h>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "../common/graph.h"
+#include "../common/partition.h"
+#include "page_rank_gather.h"
+
+// out[0..k) = sum of the k-wide contribution rows of one vertex's
+// incoming neighbors.  Every column is added in neighbor order, so
+// column j comes out the same whatever k is.
+typedef void (*sum_rows_fn)(const Vertex *neighbors, int count, const double *contrib,
+                            int k, double *out);
+
+static void sum_rows_scalar(const Vertex *neighbors, int count, const double *contrib,
+                            int k, double *out)
+{
+  for (int j = 0; j < k; ++j)
+    out[j] = 0.0;
+  for (int i = 0; i < count; ++i)
+  {
+    const double *row = contrib + (size_t)neighbors[i] * k;
+    for (int j = 0; j < k; ++j)
+      out[j] += row[j];
+  }
+}
+
+#ifdef HAVE_X86_SIMD
+// Sixteen columns at a time stay in four registers while the neighbor
+// list is walked, so each neighbor's row is loaded once per block.
+__attribute__((target("avx2")))
+static void sum_rows_avx2(const Vertex *neighbors, int count, const double *contrib,
+                          int k, double *out)
+{
+  int j = 0;
+  for (; j + 16 <= k; j += 16)
+  {
+    __m256d sum0 = _mm256_setzero_pd();
+    __m256d sum1 = _mm256_setzero_pd();
+    __m256d sum2 = _mm256_setzero_pd();
+    __m256d sum3 = _mm256_setzero_pd();
+    for (int i = 0; i < count; ++i)
+    {
+      const double *row = contrib + (size_t)neighbors[i] * k + j;
+      sum0 = _mm256_add_pd(sum0, _mm256_loadu_pd(row));
+      sum1 = _mm256_add_pd(sum1, _mm256_loadu_pd(row + 4));
+      sum2 = _mm256_add_pd(sum2, _mm256_loadu_pd(row + 8));
+      sum3 = _mm256_add_pd(sum3, _mm256_loadu_pd(row + 12));
+    }
+    _mm256_storeu_pd(out + j, sum0);
+    _mm256_storeu_pd(out + j + 4, sum1);
+    _mm256_storeu_pd(out + j + 8, sum2);
+    _mm256_storeu_pd(out + j + 12, sum3);
+  }
+  for (; j + 4 <= k; j += 4)
+  {
+    __m256d sum = _mm256_setzero_pd();
+    for (int i = 0; i < count; ++i)
+      sum = _mm256_add_pd(sum, _mm256_loadu_pd(contrib + (size_t)neighbors[i] * k + j));
+    _mm256_storeu_pd(out + j, sum);
+  }
+  for (; j < k; ++j)
+  {
+    double sum = 0.0;
+    for (int i = 0; i < count; ++i)
+      sum += contrib[(size_t)neighbors[i] * k + j];
+    out[j] = sum;
+  }
+}
+#endif
+
+static sum_rows_fn select_sum_rows()
+{
+#ifdef HAVE_X86_SIMD
+  if (gather_use_avx2())
+    return sum_rows_avx2;
+#endif
+  return sum_rows_scalar;
+}
+
+static const sum_rows_fn sum_rows = select_sum_rows();
+
+// pageRankBatched --
+//
+// k personalized PageRanks in one pull pass per iteration.  teleport
+// and solution are num_nodes x k, row-major: column j of teleport is a
+// probability distribution, and a random surfer in column j that jumps
+// (with probability 1 - damping, or from a vertex without outgoing
+// edges) lands on a vertex drawn from it.  With a uniform teleport
+// column this is pageRank.
+//
+// Each column stops iterating once its own L1 change drops below
+// convergence, so it ends exactly where a run with k = 1 would.
+void pageRankBatched(Graph g, double *solution, const double *teleport, int k,
+                     double damping, double convergence, pr_stats *stats)
+{
+  int numNodes = num_nodes(g);
+  size_t cells = (size_t)numNodes * k;
+  // scores and contributions are double buffered as in pageRank
+  double *scoreOld = solution;
+  double *scoreNew = new double[cells];
+  double *contribOld = new double[cells];
+  double *contribNew = new double[cells];
+  int parts = omp_get_max_threads() * PARTS_PER_THREAD;
+  std::vector<int> boundaries(parts + 1);
+  partition_vertices(g->incoming_starts, numNodes, g->num_edges, parts, boundaries.data());
+
+  // every column starts from its own teleport distribution
+  #pragma omp parallel for
+  for (int v = 0; v < numNodes; ++v)
+  {
+    int degree = outgoing_degree(g, v);
+    for (int j = 0; j < k; ++j)
+    {
+      size_t cell = (size_t)v * k + j;
+      scoreOld[cell] = teleport[cell];
+      contribOld[cell] = (degree == 0) ? 0.0 : teleport[cell] / degree;
+    }
+  }
+  std::vector<double> noOutgoingScore(k, 0.0);
+  for (int i = 0; i < g->num_dangling; ++i)
+  {
+    for (int j = 0; j < k; ++j)
+      noOutgoingScore[j] += scoreOld[(size_t)g->dangling_vertices[i] * k + j];
+  }
+
+  std::vector<char> active(k, 1);
+  // the mass of column j that lands by teleport this iteration
+  std::vector<double> jump(k);
+  double *globalDiff = new double[k];
+  double *nextNoOutgoingScore = new double[k];
+  int remaining = k;
+  int iterations = 0;
+  while (remaining > 0) {
+    for (int j = 0; j < k; ++j)
+    {
+      jump[j] = (1.0 - damping) + damping * noOutgoingScore[j];
+      globalDiff[j] = 0.0;
+      nextNoOutgoingScore[j] = 0.0;
+    }
+    #pragma omp parallel
+    {
+      std::vector<double> sum(k);
+      #pragma omp for schedule(dynamic, 1) \
+        reduction(+: globalDiff[:k], nextNoOutgoingScore[:k])
+      for (int part = 0; part < parts; ++part)
+      {
+        for (int v = boundaries[part]; v < boundaries[part + 1]; ++v)
+        {
+          sum_rows(incoming_begin(g, v), incoming_size(g, v), contribOld, k, sum.data());
+          int degree = outgoing_degree(g, v);
+          for (int j = 0; j < k; ++j)
+          {
+            size_t cell = (size_t)v * k + j;
+            double score = active[j] ? damping * sum[j] + jump[j] * teleport[cell]
+                                     : scoreOld[cell];
+            scoreNew[cell] = score;
+            contribNew[cell] = (degree == 0) ? 0.0 : score / degree;
+            globalDiff[j] += fabs(score - scoreOld[cell]);
+            if (degree == 0)
+              nextNoOutgoingScore[j] += score;
+          }
+        }
+      }
+    }
+    std::swap(scoreOld, scoreNew);
+    std::swap(contribOld, contribNew);
+    iterations++;
+    for (int j = 0; j < k; ++j)
+    {
+      noOutgoingScore[j] = nextNoOutgoingScore[j];
+      if (active[j] && globalDiff[j] < convergence) {
+        active[j] = 0;
+        remaining--;
+      }
+    }
+  }
+
+  if (scoreOld != solution)
+  {
+    #pragma omp parallel for
+    for (size_t i = 0; i < cells; ++i)
+      solution[i] = scoreOld[i];
+    scoreNew = scoreOld;
+  }
+  if (stats) {
+    stats->iterations = iterations;
+    stats->edges = (long long)iterations * g->num_edges;
+  }
+  delete[] scoreNew;
+  delete[] contribOld;
+  delete[] contribNew;
+  delete[] globalDiff;
+  delete[] nextNoOutgoingScore;
+}
+
+void pageRankPersonalized(Graph g, double *solution, const double *teleport,
+                          double damping, double convergence, pr_stats *stats)
+{
+  pageRankBatched(g, solution, teleport, 1, damping, convergence, stats);
+}
+
+// pprForwardPush --
+//
+// Approximate personalized PageRank of a single seed by local pushes
+// (Andersen, Chung and Lang): residual mass starts on the seed, and a
+// vertex holding at least epsilon per outgoing edge keeps 1 - damping
+// of it and passes the rest to its out-neighbors, or back to the seed
+// if it has none.  Only the neighborhood the mass reaches is touched.
+// The L1 error is the residual left behind, at most epsilon * num_edges.
+void pprForwardPush(Graph g, Vertex seed, double damping, double epsilon, double *solution)
+{
+  int numNodes = num_nodes(g);
+  double *residual = new double[numNodes];
+  char *queued = new char[numNodes];
+  memset(residual, 0, sizeof(double) * numNodes);
+  memset(queued, 0, numNodes);
+  for (int i = 0; i < numNodes; ++i)
+    solution[i] = 0.0;
+
+  std::vector<Vertex> queue;
+  queue.push_back(seed);
+  queued[seed] = 1;
+  residual[seed] = 1.0;
+  for (size_t head = 0; head < queue.size(); ++head)
+  {
+    Vertex u = queue[head];
+    queued[u] = 0;
+    int degree = outgoing_degree(g, u);
+    double mass = residual[u];
+    if (mass < epsilon * std::max(degree, 1))
+      continue;
+    residual[u] = 0.0;
+    solution[u] += (1.0 - damping) * mass;
+    if (degree == 0) {
+      residual[seed] += damping * mass;
+      if (!queued[seed] && residual[seed] >= epsilon * std::max(outgoing_degree(g, seed), 1)) {
+        queued[seed] = 1;
+        queue.push_back(seed);
+      }
+      continue;
+    }
+    double push = damping * mass / degree;
+    for (const Vertex *v = outgoing_begin(g, u); v != outgoing_end(g, u); ++v)
+    {
+      residual[*v] += push;
+      if (!queued[*v] && residual[*v] >= epsilon * std::max(outgoing_degree(g, *v), 1)) {
+        queued[*v] = 1;
+        queue.push_back(*v);
+      }
+    }
+  }
+
+  delete[] residual;
+  delete[] queued;
+}
+
+// pprMonteCarlo --
+//
+// Approximate personalized PageRank of a single seed from random walks:
+// each walk starts on the seed and takes another step with probability
+// damping, jumping back to the seed from vertices without outgoing
+// edges.  The share of walks ending on v estimates its score.  Walks
+// are split over the threads, each with its own generator.
+void pprMonteCarlo(Graph g, Vertex seed, double damping, long long walks,
+                   unsigned int rngSeed, double *solution)
+{
+  int numNodes = num_nodes(g);
+  long long *ends = new long long[numNodes];
+  memset(ends, 0, sizeof(long long) * numNodes);
+
+  #pragma omp parallel
+  {
+    std::mt19937 rng(rngSeed + omp_get_thread_num());
+    std::uniform_real_distribution<double> coin(0.0, 1.0);
+    #pragma omp for schedule(static)
+    for (long long w = 0; w < walks; ++w)
+    {
+      Vertex v = seed;
+      while (coin(rng) < damping) {
+        int degree = outgoing_degree(g, v);
+        v = (degree == 0) ? seed : outgoing_begin(g, v)[rng() % degree];
+      }
+      __sync_fetch_and_add(&ends[v], 1);
+    }
+  }
+
+  #pragma omp parallel for
+  for (int i = 0; i < numNodes; ++i)
+    solution[i] = (double)ends[i] / walks;
+  delete[] ends;
+}
@@ -0,0 +1,184 @@
+#include "page_rank.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <cmath>
+#include <omp.h>
+#include <utility>
+#include <vector>
+
+#include "../common/graph.h"
+#include "../common/partition.h"
+#include "page_rank_gather.h"
+
+// Destinations are binned by id: a bin covers 2^BIN_SHIFT vertices,
+// whose 8-byte sums (256 KB) stay in the L2 cache while it is summed.
+#define BIN_SHIFT 15
+// Push pays off once the scores outgrow the last-level cache, so the
+// pull's random reads miss, and there are enough edges per vertex to
+// amortize the binning.  See pageRankPrefersPush.
+#define PUSH_MIN_NODES (1 << 22)
+#define PUSH_MIN_AVG_DEGREE 8
+
+// PR_DIRECTION=push or pull in the environment overrides the choice,
+// so both sides can be exercised on any graph
+bool pageRankPrefersPush(Graph g)
+{
+  const char *forced = getenv("PR_DIRECTION");
+  if (forced && !strcmp(forced, "push"))
+    return true;
+  if (forced && !strcmp(forced, "pull"))
+    return false;
+  return g->num_nodes >= PUSH_MIN_NODES &&
+         g->num_edges >= (long long)PUSH_MIN_AVG_DEGREE * g->num_nodes;
+}
+
+// pageRankPush --
+//
+// Same result as pageRank, computed from the outgoing edges only with
+// propagation blocking.  Each iteration has two phases:
+//
+//   binning:      every source part streams the contribution of each
+//                 outgoing edge into the bin of its destination;
+//   accumulation: each bin sums its values into its slice of the new
+//                 scores, which fits in cache, then finishes the scores.
+//
+// The edges never move, so the destination of every binned slot is
+// fixed: it is written once up front and each iteration only writes
+// the values, in the same order.
+void pageRankPush(Graph g, double *solution, double damping, double convergence,
+                  pr_stats *stats)
+{
+  int numNodes = num_nodes(g);
+  double equalProb = 1.0 / numNodes;
+  int numBins = (numNodes + (1 << BIN_SHIFT) - 1) >> BIN_SHIFT;
+  // sources are split by outgoing edges, the binning pass's work
+  int parts = omp_get_max_threads() * PARTS_PER_THREAD;
+  std::vector<int> boundaries(parts + 1);
+  partition_vertices(g->outgoing_starts, numNodes, g->num_edges, parts, boundaries.data());
+
+  // slots of part p in bin b start at offsets[p * numBins + b]; bins
+  // are contiguous, parts in order within a bin
+  std::vector<long long> offsets((size_t)parts * numBins, 0);
+  std::vector<long long> binStarts(numBins + 1, 0);
+  #pragma omp parallel for schedule(dynamic, 1)
+  for (int part = 0; part < parts; ++part)
+  {
+    long long *counts = &offsets[(size_t)part * numBins];
+    for (int u = boundaries[part]; u < boundaries[part + 1]; ++u)
+    {
+      for (const Vertex *v = outgoing_begin(g, u); v != outgoing_end(g, u); ++v)
+        counts[*v >> BIN_SHIFT]++;
+    }
+  }
+  long long running = 0;
+  for (int bin = 0; bin < numBins; ++bin)
+  {
+    binStarts[bin] = running;
+    for (int part = 0; part < parts; ++part)
+    {
+      long long count = offsets[(size_t)part * numBins + bin];
+      offsets[(size_t)part * numBins + bin] = running;
+      running += count;
+    }
+  }
+  binStarts[numBins] = running;
+
+  Vertex *binnedDest = new Vertex[std::max(running, 1LL)];
+  double *binnedValue = new double[std::max(running, 1LL)];
+  #pragma omp parallel for schedule(dynamic, 1)
+  for (int part = 0; part < parts; ++part)
+  {
+    std::vector<long long> cursor(&offsets[(size_t)part * numBins],
+                                  &offsets[(size_t)part * numBins] + numBins);
+    for (int u = boundaries[part]; u < boundaries[part + 1]; ++u)
+    {
+      for (const Vertex *v = outgoing_begin(g, u); v != outgoing_end(g, u); ++v)
+        binnedDest[cursor[*v >> BIN_SHIFT]++] = *v;
+    }
+  }
+
+  double *scoreOld = solution;
+  double *scoreNew = new double[numNodes];
+  double *contrib = new double[numNodes];
+  double noOutgoingScore = g->num_dangling * equalProb;
+  #pragma omp parallel for
+  for (int i = 0; i < numNodes; ++i)
+  {
+    int degree = outgoing_degree(g, i);
+    scoreOld[i] = equalProb;
+    contrib[i] = (degree == 0) ? 0.0 : equalProb / degree;
+  }
+
+  double teleport = (1.0 - damping) / numNodes;
+  int iterations = 0;
+  bool converged = false;
+  while (!converged) {
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (int part = 0; part < parts; ++part)
+    {
+      std::vector<long long> cursor(&offsets[(size_t)part * numBins],
+                                    &offsets[(size_t)part * numBins] + numBins);
+      for (int u = boundaries[part]; u < boundaries[part + 1]; ++u)
+      {
+        double value = contrib[u];
+        for (const Vertex *v = outgoing_begin(g, u); v != outgoing_end(g, u); ++v)
+          binnedValue[cursor[*v >> BIN_SHIFT]++] = value;
+      }
+    }
+
+    double base = teleport + damping * noOutgoingScore / numNodes;
+    double globalDiff = 0.0;
+    double nextNoOutgoingScore = 0.0;
+    #pragma omp parallel for schedule(dynamic, 1) reduction(+: globalDiff, nextNoOutgoingScore)
+    for (int bin = 0; bin < numBins; ++bin)
+    {
+      int first = bin << BIN_SHIFT;
+      int last = std::min(numNodes, first + (1 << BIN_SHIFT));
+      for (int v = first; v < last; ++v)
+        scoreNew[v] = 0.0;
+      for (long long k = binStarts[bin]; k < binStarts[bin + 1]; ++k)
+        scoreNew[binnedDest[k]] += binnedValue[k];
+      for (int v = first; v < last; ++v)
+      {
+        double score = damping * scoreNew[v] + base;
+        int degree = outgoing_degree(g, v);
+        scoreNew[v] = score;
+        contrib[v] = (degree == 0) ? 0.0 : score / degree;
+        globalDiff += fabs(score - scoreOld[v]);
+        if (degree == 0)
+          nextNoOutgoingScore += score;
+      }
+    }
+    std::swap(scoreOld, scoreNew);
+    noOutgoingScore = nextNoOutgoingScore;
+    converged = globalDiff < convergence;
+    iterations++;
+  }
+  if (stats) {
+    stats->iterations = iterations;
+    stats->edges = (long long)iterations * g->num_edges;
+  }
+
+  if (scoreOld != solution)
+  {
+    #pragma omp parallel for
+    for (int i = 0; i < numNodes; ++i)
+      solution[i] = scoreOld[i];
+    scoreNew = scoreOld;
+  }
+  delete[] scoreNew;
+  delete[] contrib;
+  delete[] binnedDest;
+  delete[] binnedValue;
+}
+
+void pageRankAuto(Graph g, double *solution, double damping, double convergence,
+                  pr_stats *stats)
+{
+  if (pageRankPrefersPush(g))
+    pageRankPush(g, solution, damping, convergence, stats);
+  else
+    pageRank(g, solution, damping, convergence, stats);
+}
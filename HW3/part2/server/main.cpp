@@ -0,0 +1,353 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <omp.h>
+#include <string>
+#include <getopt.h>
+#include <cmath>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "common/CycleTimer.h"
+#include "common/graph.h"
+#include "query_server.h"
+
+#define DEFAULT_HOPS 2
+#define DEFAULT_BFS_FRACTION 0.02
+#define DEFAULT_SEED 15418
+// closed-loop clients per thread in the benchmark
+#define CLIENTS_PER_THREAD 2
+
+// Answers are written as "<id> <reached> <depth> <latency_us>" or
+// "<id> error <message>", ids counting request lines from 0.  Queries
+// run concurrently, so answers can come back out of order.  The caller
+// holds the lock of out; false if the answer could not be written.
+static bool write_answer(FILE* out, const query& q, const query_result& r)
+{
+    fprintf(out, "%lld %d %d %.1f\n", q.id, r.reached, r.depth, r.latency * 1e6);
+    return fflush(out) == 0;
+}
+
+static std::mutex stdout_lock;
+
+static void stdin_reply(void*, const query& q, const query_result& r)
+{
+    std::lock_guard<std::mutex> guard(stdout_lock);
+    write_answer(stdout, q, r);
+}
+
+static void serve_stdin(Graph g, query_server* server)
+{
+    std::string line;
+    long long id = 0;
+    while (std::getline(std::cin, line)) {
+        if (line.empty())
+            continue;
+        query q;
+        std::string error;
+        q.id = id++;
+        if (!parse_query(g, line, &q, &error)) {
+            std::lock_guard<std::mutex> guard(stdout_lock);
+            printf("%lld error %s\n", q.id, error.c_str());
+            fflush(stdout);
+            continue;
+        }
+        q.reply = stdin_reply;
+        q.context = NULL;
+        server_submit(server, q);
+    }
+    server_drain(server);
+}
+
+// One client of the socket server.  The reader closes the connection
+// after the client hangs up and its last answer has been written.  Once
+// a write fails because the client is gone (EPIPE, ECONNRESET), the
+// connection is broken: the answers still due are dropped and no more
+// requests are read.
+struct connection {
+    FILE* out;
+    std::mutex write_lock;
+    bool broken = false;
+    std::mutex lock;
+    std::condition_variable answered;
+    int pending = 0;
+};
+
+// Called with write_lock held after a failed write
+static void connection_failed(connection* conn)
+{
+    if (errno != EPIPE && errno != ECONNRESET)
+        perror("write to client");
+    conn->broken = true;
+}
+
+static void socket_reply(void* context, const query& q, const query_result& r)
+{
+    connection* conn = (connection*)context;
+    {
+        std::lock_guard<std::mutex> guard(conn->write_lock);
+        if (!conn->broken && !write_answer(conn->out, q, r))
+            connection_failed(conn);
+    }
+    std::lock_guard<std::mutex> guard(conn->lock);
+    if (--conn->pending == 0)
+        conn->answered.notify_all();
+}
+
+static void serve_connection(Graph g, query_server* server, int fd)
+{
+    connection conn;
+    conn.out = fdopen(dup(fd), "w");
+    FILE* in = fdopen(fd, "r");
+    char* buffer = NULL;
+    size_t size = 0;
+    long long id = 0;
+    ssize_t length;
+    while ((length = getline(&buffer, &size, in)) > 0) {
+        std::string line(buffer, length);
+        if (line.find_first_not_of(" \t\r\n") == std::string::npos)
+            continue;
+        query q;
+        std::string error;
+        q.id = id++;
+        {
+            std::lock_guard<std::mutex> guard(conn.write_lock);
+            if (conn.broken)
+                break;
+        }
+        if (!parse_query(g, line, &q, &error)) {
+            std::lock_guard<std::mutex> guard(conn.write_lock);
+            fprintf(conn.out, "%lld error %s\n", q.id, error.c_str());
+            if (fflush(conn.out) != 0)
+                connection_failed(&conn);
+            continue;
+        }
+        q.reply = socket_reply;
+        q.context = &conn;
+        {
+            std::lock_guard<std::mutex> guard(conn.lock);
+            conn.pending++;
+        }
+        server_submit(server, q);
+    }
+    std::unique_lock<std::mutex> guard(conn.lock);
+    conn.answered.wait(guard, [&] { return conn.pending == 0; });
+    free(buffer);
+    fclose(in);
+    fclose(conn.out);
+}
+
+static void serve_socket(Graph g, query_server* server, const std::string& path)
+{
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (listener < 0 || path.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Cannot create socket " << path << "\n";
+        exit(1);
+    }
+    path.copy(address.sun_path, path.size());
+    unlink(path.c_str());
+    if (bind(listener, (sockaddr*)&address, sizeof(address)) != 0 || listen(listener, 64) != 0) {
+        perror(path.c_str());
+        exit(1);
+    }
+    // a client that hangs up before its answers are written must cost
+    // only its own connection: writes to it fail with EPIPE instead
+    signal(SIGPIPE, SIG_IGN);
+    fprintf(stderr, "Listening on %s\n", path.c_str());
+    while (true) {
+        int fd = accept(listener, NULL, NULL);
+        if (fd < 0)
+            continue;
+        std::thread(serve_connection, g, server, fd).detach();
+    }
+}
+
+// Closed-loop load: each client submits its next query as soon as the
+// previous one is answered.
+struct load_state {
+    query_server* server;
+    const std::vector<query>* queries;
+    std::atomic<int> next;
+    std::vector<double> latencies;
+    std::vector<int> reached;
+    std::mutex lock;
+    std::condition_variable finished;
+    int completed;
+};
+
+static void load_reply(void* context, const query& q, const query_result& r)
+{
+    load_state* load = (load_state*)context;
+    load->latencies[q.id] = r.latency;
+    load->reached[q.id] = r.reached;
+    int n = load->next++;
+    if (n < (int)load->queries->size())
+        server_submit(load->server, (*load->queries)[n]);
+    std::lock_guard<std::mutex> guard(load->lock);
+    if (++load->completed == (int)load->queries->size())
+        load->finished.notify_all();
+}
+
+static double percentile(const std::vector<double>& sorted, double p)
+{
+    size_t rank = (size_t)ceil(p * sorted.size());
+    return sorted[std::max(rank, (size_t)1) - 1];
+}
+
+static bool benchmark(Graph g, int threads, int num_queries, int clients, int max_hops,
+                      double bfs_fraction, unsigned int seed)
+{
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> pick(0, g->num_nodes - 1);
+    std::uniform_real_distribution<double> coin(0.0, 1.0);
+    std::vector<query> queries(num_queries);
+    int num_bfs = 0;
+    for (int i = 0; i < num_queries; i++) {
+        queries[i].id = i;
+        queries[i].kind = (coin(rng) < bfs_fraction) ? QUERY_BFS : QUERY_KHOP;
+        queries[i].max_hops = max_hops;
+        queries[i].seeds.push_back(pick(rng));
+        num_bfs += queries[i].kind == QUERY_BFS;
+    }
+    printf("Load: %d queries (%d full BFS, %d %d-hop), %d clients\n",
+           num_queries, num_bfs, num_queries - num_bfs, max_hops, clients);
+
+    std::stringstream timing;
+    timing << "Policy      p50 (ms)   p99 (ms)   Queries/sec\n";
+    std::vector<int> expected;
+    bool check = true;
+    for (parallel_policy policy : {POLICY_INTRA, POLICY_INTER, POLICY_ADAPTIVE}) {
+        load_state load;
+        load.server = server_start(g, threads, policy);
+        load.queries = &queries;
+        load.latencies.assign(num_queries, 0.0);
+        load.reached.assign(num_queries, -1);
+        load.completed = 0;
+        int initial = std::min(clients, num_queries);
+        load.next = initial;
+        for (query& q : queries) {
+            q.reply = load_reply;
+            q.context = &load;
+        }
+
+        double start = CycleTimer::currentSeconds();
+        for (int i = 0; i < initial; i++)
+            server_submit(load.server, queries[i]);
+        {
+            std::unique_lock<std::mutex> guard(load.lock);
+            load.finished.wait(guard, [&] { return load.completed == num_queries; });
+        }
+        double time = CycleTimer::currentSeconds() - start;
+        server_stop(load.server);
+
+        // every policy must give the same answers
+        if (expected.empty())
+            expected = load.reached;
+        else if (load.reached != expected)
+            check = false;
+
+        std::sort(load.latencies.begin(), load.latencies.end());
+        char buf[1024];
+        sprintf(buf, "%-10s  %8.3f   %8.3f   %11.1f\n", policy_name(policy),
+                percentile(load.latencies, 0.50) * 1e3, percentile(load.latencies, 0.99) * 1e3,
+                num_queries / time);
+        timing << buf;
+    }
+
+    printf("----------------------------------------------------------\n");
+    std::cout << "Latency Summary" << std::endl;
+    std::cout << timing.str();
+    printf("----------------------------------------------------------\n");
+    if (!check)
+        std::cout << "Query Server is not Correct" << std::endl;
+    return check;
+}
+
+static void usage(const char* binary)
+{
+    std::cerr << "Usage: " << binary << " <path/to/graph/file> [-t threads] [-p policy] [-l socket] [-b queries [-c clients] [-k hops] [-m bfs_fraction] [-r seed]]\n";
+    std::cerr << "  Serves requests from stdin, or from the unix socket given with -l:\n";
+    std::cerr << "    bfs <root>\n";
+    std::cerr << "    khop <hops> <seed> [<seed> ...]\n";
+    std::cerr << "  answering \"<id> <reached> <depth> <latency_us>\" per request line.\n";
+    std::cerr << "  -p: adaptive (default), intra (one query at a time on all threads) or inter (one per thread)\n";
+    std::cerr << "  -b: instead run a synthetic load of that many queries under each policy\n";
+}
+
+int main(int argc, char** argv) {
+
+    int thread_count = -1;
+    parallel_policy policy = POLICY_ADAPTIVE;
+    std::string socket_path;
+    int num_queries = 0;
+    int clients = -1;
+    int max_hops = DEFAULT_HOPS;
+    double bfs_fraction = DEFAULT_BFS_FRACTION;
+    unsigned int seed = DEFAULT_SEED;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "t:p:l:b:c:k:m:r:h")) != -1) {
+        switch (opt) {
+        case 't': thread_count = atoi(optarg); break;
+        case 'p':
+            if (!parse_policy(optarg, &policy)) {
+                usage(argv[0]);
+                exit(1);
+            }
+            break;
+        case 'l': socket_path = optarg; break;
+        case 'b': num_queries = atoi(optarg); break;
+        case 'c': clients = atoi(optarg); break;
+        case 'k': max_hops = atoi(optarg); break;
+        case 'm': bfs_fraction = atof(optarg); break;
+        case 'r': seed = atoi(optarg); break;
+        default: usage(argv[0]); exit(1);
+        }
+    }
+    if (optind + 1 != argc) {
+        usage(argv[0]);
+        exit(1);
+    }
+    std::string graph_filename = argv[optind];
+
+    int threads = omp_get_max_threads();
+    if (thread_count > 0)
+        threads = std::min(thread_count, threads);
+    if (clients <= 0)
+        clients = CLIENTS_PER_THREAD * threads;
+
+    // the banner goes to stderr so stdout carries only answers
+    fprintf(stderr, "Loading graph...\n");
+    Graph g = load_graph_binary(graph_filename.c_str());
+    fprintf(stderr, "Graph: %d nodes, %d edges; %d threads, %s policy\n",
+            g->num_nodes, g->num_edges, threads, policy_name(policy));
+
+    bool ok = true;
+    if (num_queries > 0) {
+        ok = benchmark(g, threads, num_queries, clients, max_hops, bfs_fraction, seed);
+    } else {
+        query_server* server = server_start(g, threads, policy);
+        if (socket_path.empty())
+            serve_stdin(g, server);
+        else
+            serve_socket(g, server, socket_path);
+        server_stop(server);
+    }
+
+    free_graph(g);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,197 @@
+#include "query_server.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <omp.h>
+#include <stdlib.h>
+
+#include "common/CycleTimer.h"
+#include "common/graph.h"
+#include "breadth_first_search/bfs.h"
+#include "khop/khop.h"
+
+struct query_server {
+  Graph graph;
+  parallel_policy policy;
+  // threads shared by all queries in flight
+  int threads;
+  std::vector<std::thread> workers;
+
+  std::mutex lock;
+  std::condition_variable ready;
+  std::condition_variable idle;
+  std::deque<query> queue;
+  int running;
+  bool stopping;
+};
+
+// Threads for the next query, given how many queries are in flight or
+// waiting (including it).
+static int query_threads(query_server *server, int load) {
+  switch (server->policy) {
+  case POLICY_INTRA:
+    return server->threads;
+  case POLICY_INTER:
+    return 1;
+  default:
+    return std::max(1, server->threads / std::max(1, load));
+  }
+}
+
+static query_result run_query(Graph graph, const query &q, solution *sol, khop_workspace *ws) {
+  query_result result;
+  if (q.kind == QUERY_BFS) {
+    bfs_hybrid_from(graph, q.seeds[0], sol);
+    int reached = 0, depth = 0;
+    #pragma omp parallel for reduction(+:reached) reduction(max:depth)
+    for (int v = 0; v < graph->num_nodes; v++) {
+      if (sol->distances[v] >= 0) {
+        reached++;
+        depth = std::max(depth, sol->distances[v]);
+      }
+    }
+    result.reached = reached;
+    result.depth = depth;
+  } else {
+    result.reached = khop_query(graph, q.seeds.data(), q.seeds.size(), q.max_hops, ws);
+    result.depth = ws->level_starts.size() - 2;
+  }
+  return result;
+}
+
+static void worker_loop(query_server *server) {
+  solution sol;
+  sol.distances = (int *)malloc(sizeof(int) * server->graph->num_nodes);
+  khop_workspace ws;
+  khop_workspace_init(&ws, server->graph);
+
+  while (true) {
+    query q;
+    int threads;
+    {
+      std::unique_lock<std::mutex> guard(server->lock);
+      server->ready.wait(guard, [&] { return server->stopping || !server->queue.empty(); });
+      if (server->queue.empty())
+        break;
+      q = std::move(server->queue.front());
+      server->queue.pop_front();
+      server->running++;
+      threads = query_threads(server, server->running + server->queue.size());
+    }
+
+    // the thread count is per calling thread, so workers don't interfere
+    omp_set_num_threads(threads);
+    query_result result = run_query(server->graph, q, &sol, &ws);
+    result.latency = CycleTimer::currentSeconds() - q.submitted;
+    q.reply(q.context, q, result);
+
+    std::lock_guard<std::mutex> guard(server->lock);
+    server->running--;
+    if (server->running == 0 && server->queue.empty())
+      server->idle.notify_all();
+  }
+
+  khop_workspace_free(&ws);
+  free(sol.distances);
+}
+
+query_server *server_start(Graph graph, int threads, parallel_policy policy) {
+  query_server *server = new query_server;
+  server->graph = graph;
+  server->policy = policy;
+  server->threads = std::max(1, threads);
+  server->running = 0;
+  server->stopping = false;
+  int workers = (policy == POLICY_INTRA) ? 1 : server->threads;
+  for (int i = 0; i < workers; i++)
+    server->workers.emplace_back(worker_loop, server);
+  return server;
+}
+
+void server_submit(query_server *server, query q) {
+  q.submitted = CycleTimer::currentSeconds();
+  {
+    std::lock_guard<std::mutex> guard(server->lock);
+    server->queue.push_back(std::move(q));
+  }
+  server->ready.notify_one();
+}
+
+void server_drain(query_server *server) {
+  std::unique_lock<std::mutex> guard(server->lock);
+  server->idle.wait(guard, [&] { return server->running == 0 && server->queue.empty(); });
+}
+
+void server_stop(query_server *server) {
+  server_drain(server);
+  {
+    std::lock_guard<std::mutex> guard(server->lock);
+    server->stopping = true;
+  }
+  server->ready.notify_all();
+  for (std::thread &worker : server->workers)
+    worker.join();
+  delete server;
+}
+
+bool parse_query(Graph graph, const std::string &line, query *q, std::string *error) {
+  std::istringstream in(line);
+  std::string command;
+  in >> command;
+  q->seeds.clear();
+  if (command == "bfs") {
+    q->kind = QUERY_BFS;
+    q->max_hops = KHOP_UNBOUNDED;
+  } else if (command == "khop") {
+    q->kind = QUERY_KHOP;
+    if (!(in >> q->max_hops)) {
+      *error = "missing hop count";
+      return false;
+    }
+  } else {
+    *error = "unknown command '" + command + "'";
+    return false;
+  }
+  Vertex v;
+  while (in >> v) {
+    if (v < 0 || v >= graph->num_nodes) {
+      *error = "vertex " + std::to_string(v) + " out of range";
+      return false;
+    }
+    q->seeds.push_back(v);
+  }
+  if (!in.eof()) {
+    *error = "bad vertex id";
+    return false;
+  }
+  if (q->seeds.empty() || (q->kind == QUERY_BFS && q->seeds.size() != 1)) {
+    *error = (q->kind == QUERY_BFS) ? "bfs takes one root" : "khop needs a seed";
+    return false;
+  }
+  return true;
+}
+
+bool parse_policy(const std::string &name, parallel_policy *policy) {
+  for (parallel_policy p : {POLICY_ADAPTIVE, POLICY_INTRA, POLICY_INTER}) {
+    if (name == policy_name(p)) {
+      *policy = p;
+      return true;
+    }
+  }
+  return false;
+}
+
+const char *policy_name(parallel_policy policy) {
+  switch (policy) {
+  case POLICY_INTRA:
+    return "intra";
+  case POLICY_INTER:
+    return "inter";
+  default:
+    return "adaptive";
+  }
+}
@@ -0,0 +1,61 @@
+#ifndef __QUERY_SERVER_H__
+#define __QUERY_SERVER_H__
+
+#include <string>
+#include <vector>
+
+#include "common/graph.h"
+
+// Long-running BFS / k-hop query service over one read-only graph.
+//
+// Queries are queued and answered by a pool of workers.  How the
+// machine's threads are spent is the policy:
+//   intra:    one query at a time, each using every thread
+//   inter:    one query per thread, each running serially
+//   adaptive: one query per thread when the queue is deep, splitting
+//             the threads among the queries in flight when it is not
+
+enum parallel_policy { POLICY_ADAPTIVE, POLICY_INTRA, POLICY_INTER };
+
+enum query_kind { QUERY_BFS, QUERY_KHOP };
+
+struct query_result {
+  // vertices reached and the largest hop count among them
+  int reached;
+  int depth;
+  // seconds from submission to answer
+  double latency;
+};
+
+struct query {
+  long long id;
+  query_kind kind;
+  // hop bound of QUERY_KHOP; QUERY_BFS searches from seeds[0]
+  int max_hops;
+  std::vector<Vertex> seeds;
+  double submitted;
+  // called from a worker thread with the answer
+  void (*reply)(void* context, const query& q, const query_result& result);
+  void* context;
+};
+
+struct query_server;
+
+query_server* server_start(Graph graph, int threads, parallel_policy policy);
+// Queue q; submitted is set here
+void server_submit(query_server* server, query q);
+// Wait until every submitted query has been answered
+void server_drain(query_server* server);
+// Drain, then stop the workers and free the server
+void server_stop(query_server* server);
+
+// Request line protocol:
+//   bfs <root>
+//   khop <hops> <seed> [<seed> ...]
+// Fills kind, max_hops and seeds, or returns false with error set.
+bool parse_query(Graph graph, const std::string& line, query* q, std::string* error);
+
+bool parse_policy(const std::string& name, parallel_policy* policy);
+const char* policy_name(parallel_policy policy);
+
+#endif
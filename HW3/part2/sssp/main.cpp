@@ -0,0 +1,133 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <omp.h>
+#include <string>
+
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#include "common/CycleTimer.h"
+#include "common/graph.h"
+#include "sssp.h"
+
+#define ROOT_NODE_ID 0
+#define DEFAULT_DELTA 32
+
+int main(int argc, char** argv) {
+
+    std::string graph_filename;
+
+    if (argc < 2)
+    {
+        std::cerr << "Usage: <path/to/graph/file> [delta] [num_threads]\n";
+        std::cerr << "  To run results for all thread counts: <path/to/graph/file> [delta]\n";
+        std::cerr << "  Run with a certain number of threads: <path/to/graph/file> <delta> <num_threads>\n";
+        exit(1);
+    }
+
+    int delta = DEFAULT_DELTA;
+    if (argc >= 3)
+    {
+        delta = atoi(argv[2]);
+        if (delta <= 0) {
+            std::cerr << "delta must be positive\n";
+            exit(1);
+        }
+    }
+
+    int thread_count = -1;
+    if (argc == 4)
+    {
+        thread_count = atoi(argv[3]);
+    }
+
+    graph_filename = argv[1];
+
+    Graph g;
+
+    printf("----------------------------------------------------------\n");
+    printf("Max system threads = %d\n", omp_get_max_threads());
+    if (thread_count > 0)
+    {
+        thread_count = std::min(thread_count, omp_get_max_threads());
+        printf("Running with %d threads\n", thread_count);
+    }
+    printf("----------------------------------------------------------\n");
+
+    printf("Loading graph...\n");
+    g = load_graph_binary(graph_filename.c_str());
+    printf("\n");
+    printf("Graph stats:\n");
+    printf("  Edges: %d\n", g->num_edges);
+    printf("  Nodes: %d\n", g->num_nodes);
+    printf("  Weighted: %s\n", is_weighted(g) ? "yes" : "no (unit weights)");
+    printf("  Delta: %d\n", delta);
+
+    std::vector<int> num_threads;
+    if (thread_count <= -1)
+    {
+        int max_threads = omp_get_max_threads();
+        for (int i = 1; i < max_threads; i *= 2) {
+          num_threads.push_back(i);
+        }
+        num_threads.push_back(max_threads);
+    }
+    else
+    {
+        num_threads.push_back(thread_count);
+    }
+
+    int* ref_distances = (int*)malloc(sizeof(int) * g->num_nodes);
+    int* distances = (int*)malloc(sizeof(int) * g->num_nodes);
+
+    double start = CycleTimer::currentSeconds();
+    sssp_dijkstra(g, ROOT_NODE_ID, ref_distances);
+    double dijkstra_time = CycleTimer::currentSeconds() - start;
+
+    double base_time = 0;
+    bool check = true;
+    std::stringstream timing;
+    timing << "Threads  Delta-stepping (Speedup)  vs. Dijkstra\n";
+
+    for (size_t i = 0; i < num_threads.size(); i++)
+    {
+        printf("----------------------------------------------------------\n");
+        std::cout << "Running with " << num_threads[i] << " threads" << std::endl;
+        omp_set_num_threads(num_threads[i]);
+
+        start = CycleTimer::currentSeconds();
+        sssp_delta_stepping(g, ROOT_NODE_ID, delta, distances);
+        double time = CycleTimer::currentSeconds() - start;
+        if (i == 0)
+            base_time = time;
+
+        std::cout << "Testing Correctness of Delta-stepping\n";
+        for (int j=0; j<g->num_nodes; j++) {
+            if (distances[j] != ref_distances[j]) {
+                fprintf(stderr, "*** Results disagree at %d: %d, %d\n", j, distances[j], ref_distances[j]);
+                check = false;
+                break;
+            }
+        }
+
+        char buf[1024];
+        sprintf(buf, "%4d:    %.4f (%.2fx)           %.2fx\n",
+                num_threads[i], time, base_time/time, dijkstra_time/time);
+        timing << buf;
+    }
+
+    printf("----------------------------------------------------------\n");
+    printf("Serial Dijkstra: %.4f sec\n", dijkstra_time);
+    std::cout << "Timing Summary" << std::endl;
+    std::cout << timing.str();
+    printf("----------------------------------------------------------\n");
+    if (!check)
+        std::cout << "Delta-stepping is not Correct" << std::endl;
+
+    free(ref_distances);
+    free(distances);
+    free_graph(g);
+
+    return 0;
+}
@@ -0,0 +1,185 @@
+#include "sssp.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+#include <queue>
+#include <functional>
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "breadth_first_search/bfs.h"
+#include "common/graph.h"
+
+#define NO_BIN INT_MAX
+#define RELAX_CHUNKSIZE 64
+
+static inline Weight edge_weight(Graph g, int edge) {
+  return g->outgoing_weights ? g->outgoing_weights[edge] : 1;
+}
+
+// Lower the distance of `vertex` to `newDist` if that improves it.
+// Returns true if this thread made the improvement.
+static inline bool relax(int *distances, Vertex vertex, int newDist) {
+  int oldDist = distances[vertex];
+  while (newDist < oldDist) {
+    if (__sync_bool_compare_and_swap(&distances[vertex], oldDist, newDist))
+      return true;
+    oldDist = distances[vertex];
+  }
+  return false;
+}
+
+// Implements delta-stepping SSSP.
+//
+// The shared frontier holds the vertices of the current bucket.  Each
+// thread keeps its own buckets of vertices it improved; after every
+// relaxation round the threads agree on the lowest non-empty bucket
+// and copy it into the next frontier.
+//
+// bucketOf[v] is the bucket v is waiting in: a vertex is added to a
+// bucket only when the tag changes to it, and the tag is cleared when
+// v is expanded, so a later improvement within the same bucket queues
+// it again.  A bucket then holds each vertex at most once and a round's
+// frontier at most num_nodes entries.  A vertex that moved on to a
+// lower bucket leaves a stale entry behind, skipped by its distance.
+//
+// An improved distance is less than (current + 1) * delta plus the
+// heaviest edge, so the buckets in use always fit in a window of
+// maxWeight / delta + 2 and each thread's buckets are a ring that size.
+void sssp_delta_stepping(Graph g, Vertex source, int delta, int *distances) {
+
+  vertex_set list1;
+  vertex_set list2;
+  vertex_set_init(&list1, g->num_nodes);
+  vertex_set_init(&list2, g->num_nodes);
+
+  vertex_set *frontier = &list1;
+  vertex_set *new_frontier = &list2;
+  int *bucketOf = (int *)malloc(sizeof(int) * g->num_nodes);
+
+  int maxWeight = 1;
+  int minWeight = 0;
+  if (g->outgoing_weights) {
+    maxWeight = 0;
+    #pragma omp parallel for reduction(max: maxWeight) reduction(min: minWeight)
+    for (int edge = 0; edge < g->num_edges; edge++) {
+      maxWeight = std::max(maxWeight, (int)g->outgoing_weights[edge]);
+      minWeight = std::min(minWeight, (int)g->outgoing_weights[edge]);
+    }
+  }
+  // a negative weight would give negative buckets, outside the ring
+  if (minWeight < 0) {
+    fprintf(stderr, "sssp_delta_stepping: negative edge weight %d\n", minWeight);
+    exit(1);
+  }
+  int ring = maxWeight / delta + 2;
+
+  #pragma omp parallel for
+  for (int i = 0; i < g->num_nodes; i++) {
+    distances[i] = SSSP_INFINITY;
+    bucketOf[i] = NO_BIN;
+  }
+
+  frontier->vertices[frontier->count++] = source;
+  distances[source] = 0;
+
+  int currentBin = 0;
+  int nextBin = NO_BIN;
+
+  #pragma omp parallel
+  {
+    std::vector<std::vector<Vertex>> bins(ring);
+
+    while (currentBin != NO_BIN) {
+      #pragma omp single
+      {
+        nextBin = NO_BIN;
+        vertex_set_clear(new_frontier);
+      }
+
+      long long binStart = (long long)delta * currentBin;
+      #pragma omp for schedule(dynamic, RELAX_CHUNKSIZE)
+      for (int i = 0; i < frontier->count; i++) {
+        int node = frontier->vertices[i];
+        if (distances[node] < binStart)
+          continue;
+        // cleared before the distance is read: an improvement that
+        // still sees the tag is read below, a later one queues node
+        __atomic_store_n(&bucketOf[node], NO_BIN, __ATOMIC_SEQ_CST);
+        int nodeDist = __atomic_load_n(&distances[node], __ATOMIC_SEQ_CST);
+
+        int start_edge = g->outgoing_starts[node];
+        int end_edge = (node == g->num_nodes - 1) ? g->num_edges
+                                                  : g->outgoing_starts[node + 1];
+        for (int edge = start_edge; edge < end_edge; edge++) {
+          int outgoing = g->outgoing_edges[edge];
+          int newDist = nodeDist + edge_weight(g, edge);
+          if (!relax(distances, outgoing, newDist))
+            continue;
+          int bin = newDist / delta;
+          if (__atomic_exchange_n(&bucketOf[outgoing], bin, __ATOMIC_SEQ_CST) != bin)
+            bins[bin % ring].push_back(outgoing);
+        }
+      }
+
+      for (int bin = currentBin; bin < currentBin + ring; bin++) {
+        if (!bins[bin % ring].empty()) {
+          #pragma omp critical
+          nextBin = std::min(nextBin, bin);
+          break;
+        }
+      }
+      #pragma omp barrier
+
+      if (nextBin != NO_BIN && !bins[nextBin % ring].empty()) {
+        std::vector<Vertex> &mine = bins[nextBin % ring];
+        int index = __sync_fetch_and_add(&new_frontier->count, (int)mine.size());
+        memcpy(new_frontier->vertices + index, mine.data(), sizeof(Vertex) * mine.size());
+        mine.clear();
+      }
+      #pragma omp barrier
+
+      #pragma omp single
+      {
+        std::swap(frontier, new_frontier);
+        currentBin = nextBin;
+      }
+    }
+  }
+
+  free(bucketOf);
+  free(list1.vertices);
+  free(list2.vertices);
+}
+
+void sssp_dijkstra(Graph g, Vertex source, int *distances) {
+  using Entry = std::pair<int, Vertex>;
+  std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue;
+
+  for (int i = 0; i < g->num_nodes; i++)
+    distances[i] = SSSP_INFINITY;
+  distances[source] = 0;
+  queue.push(std::make_pair(0, source));
+
+  while (!queue.empty()) {
+    auto [dist, node] = queue.top();
+    queue.pop();
+    if (dist > distances[node])
+      continue;
+
+    int start_edge = g->outgoing_starts[node];
+    int end_edge = (node == g->num_nodes - 1) ? g->num_edges
+                                              : g->outgoing_starts[node + 1];
+    for (int edge = start_edge; edge < end_edge; edge++) {
+      int outgoing = g->outgoing_edges[edge];
+      int newDist = dist + edge_weight(g, edge);
+      if (newDist < distances[outgoing]) {
+        distances[outgoing] = newDist;
+        queue.push(std::make_pair(newDist, outgoing));
+      }
+    }
+  }
+}
@@ -0,0 +1,20 @@
+#ifndef __SSSP_H__
+#define __SSSP_H__
+
+#include <climits>
+
+#include "common/graph.h"
+
+#define SSSP_INFINITY INT_MAX
+
+// Edges of an unweighted graph are treated as having weight 1.  Edge
+// weights must not be negative; sssp_delta_stepping exits on one.
+
+// Parallel delta-stepping.  delta is the bucket width: vertices with
+// tentative distance in [k*delta, (k+1)*delta) are settled together.
+void sssp_delta_stepping(Graph graph, Vertex source, int delta, int* distances);
+
+// Serial Dijkstra, used as the correctness reference.
+void sssp_dijkstra(Graph graph, Vertex source, int* distances);
+
+#endif
@@ -15,6 +15,7 @@
 #define CMD_NOOUTEDGES  "noout"
 #define CMD_NOINEDGES   "noin"
 #define CMD_EDGESTATS   "edgestats"
+#define CMD_ADDWEIGHTS  "addweights"
 
 
 void print_help(const char* binary_name) {
@@ -27,7 +28,8 @@ void print_help(const char* binary_name) {
               << CMD_PRINT << ": print graph topology (careful with big graphs)\n"
               << CMD_NOOUTEDGES << ": detect vertices with no outgoing edges\n"
               << CMD_NOINEDGES << ": detect vertices with no incoming edges\n"
-              << CMD_EDGESTATS << ": print stats on graph edges: e.g., min/max edges per node, etc.\n";
+              << CMD_EDGESTATS << ": print stats on graph edges: e.g., min/max edges per node, etc.\n"
+              << CMD_ADDWEIGHTS << ": attach uniform random edge weights to a binary graph\n";
 }
 
 int main(int argc, char** argv) {
@@ -263,6 +265,33 @@ int main(int argc, char** argv) {
                   << " avg=" << avg_incoming
                   << " min=" << min_incoming
                   << " max=" << max_incoming << "\n";
+    } else if (!cmd.compare(CMD_ADDWEIGHTS)) {
+
+        if (argc < 4) {
+            std::cerr << "Usage: " << argv[0] << " " << cmd << " infilename outfilename [max_weight] [seed]\n";
+            std::cerr << "Stores a copy of the graph with random weights in [1, max_weight] (default 255).\n";
+            exit(1);
+        }
+
+        std::string inputFilename = std::string(argv[2]);
+        std::string outputFilename = std::string(argv[3]);
+        int max_weight = (argc > 4) ? atoi(argv[4]) : 255;
+        unsigned int seed = (argc > 5) ? atoi(argv[5]) : 15418;
+
+        Graph g;
+        std::cout << "Loading graph: " << inputFilename << "\n";
+        g = load_graph_binary(inputFilename.c_str());
+        std::cout << "Done loading.\n";
+
+        free(g->outgoing_weights);
+        g->outgoing_weights = (Weight*)malloc(sizeof(Weight) * num_edges(g));
+        srand(seed);
+        for (int i=0; i<num_edges(g); i++) {
+            g->outgoing_weights[i] = 1 + rand() % max_weight;
+        }
+
+        store_graph_binary(outputFilename.c_str(), g);
+        free_graph(g);
     }
 
     else {
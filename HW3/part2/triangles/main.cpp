@@ -0,0 +1,134 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <omp.h>
+#include <string>
+
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#include "common/CycleTimer.h"
+#include "common/graph.h"
+#include "triangles.h"
+
+int main(int argc, char** argv) {
+
+    if (argc < 2)
+    {
+        std::cerr << "Usage: <path/to/graph/file> [num_threads]\n";
+        std::cerr << "  To run results for all thread counts: <path/to/graph/file>\n";
+        std::cerr << "  Run with a certain number of threads: <path/to/graph/file> <num_threads>\n";
+        exit(1);
+    }
+
+    std::string graph_filename = argv[1];
+
+    int thread_count = -1;
+    if (argc == 3)
+    {
+        thread_count = atoi(argv[2]);
+    }
+
+    printf("----------------------------------------------------------\n");
+    printf("Max system threads = %d\n", omp_get_max_threads());
+    printf("----------------------------------------------------------\n");
+
+    printf("Loading graph...\n");
+    Graph directed = load_graph_binary(graph_filename.c_str());
+    double start = CycleTimer::currentSeconds();
+    Graph g = build_undirected(directed);
+    double build_time = CycleTimer::currentSeconds() - start;
+    free_graph(directed);
+    printf("\n");
+    printf("Graph stats (undirected):\n");
+    printf("  Edges: %d\n", g->num_edges / 2);
+    printf("  Nodes: %d\n", g->num_nodes);
+    printf("  Build: %.4f sec\n", build_time);
+
+    std::vector<int> num_threads;
+    if (thread_count <= -1)
+    {
+        int max_threads = omp_get_max_threads();
+        for (int i = 1; i < max_threads; i *= 2) {
+          num_threads.push_back(i);
+        }
+        num_threads.push_back(max_threads);
+    }
+    else
+    {
+        num_threads.push_back(std::min(thread_count, omp_get_max_threads()));
+    }
+
+    long long* ref_triangles = (long long*)malloc(sizeof(long long) * g->num_nodes);
+    long long* triangles = (long long*)malloc(sizeof(long long) * g->num_nodes);
+
+    start = CycleTimer::currentSeconds();
+    long long ref_total = count_triangles_naive(g, ref_triangles);
+    double naive_time = CycleTimer::currentSeconds() - start;
+
+    double merge_base = 0, simd_base = 0;
+    bool check = true;
+    std::stringstream timing;
+    timing << "Threads  Merge (Speedup)     SIMD Merge (Speedup)   vs. Naive\n";
+
+    for (size_t i = 0; i < num_threads.size(); i++)
+    {
+        printf("----------------------------------------------------------\n");
+        std::cout << "Running with " << num_threads[i] << " threads" << std::endl;
+        omp_set_num_threads(num_threads[i]);
+
+        double times[2];
+        for (int simd = 0; simd < 2; simd++) {
+            start = CycleTimer::currentSeconds();
+            long long total = count_triangles(g, triangles, simd);
+            times[simd] = CycleTimer::currentSeconds() - start;
+
+            std::cout << "Testing Correctness of " << (simd ? "SIMD Merge" : "Merge") << "\n";
+            if (total != ref_total) {
+                fprintf(stderr, "*** Totals disagree: %lld, %lld\n", total, ref_total);
+                check = false;
+            }
+            for (int j=0; j<g->num_nodes; j++) {
+                if (triangles[j] != ref_triangles[j]) {
+                    fprintf(stderr, "*** Results disagree at %d: %lld, %lld\n", j, triangles[j], ref_triangles[j]);
+                    check = false;
+                    break;
+                }
+            }
+        }
+        if (i == 0) {
+            merge_base = times[0];
+            simd_base = times[1];
+        }
+
+        char buf[1024];
+        sprintf(buf, "%4d:    %.4f (%.2fx)     %.4f (%.2fx)        %.2fx\n",
+                num_threads[i], times[0], merge_base/times[0], times[1], simd_base/times[1],
+                naive_time/times[1]);
+        timing << buf;
+    }
+
+    double* coefficients = (double*)malloc(sizeof(double) * g->num_nodes);
+    clustering_coefficients(g, ref_triangles, coefficients);
+    double average = 0;
+    for (int j=0; j<g->num_nodes; j++)
+        average += coefficients[j];
+    average /= g->num_nodes;
+
+    printf("----------------------------------------------------------\n");
+    printf("Naive: %.4f sec\n", naive_time);
+    printf("Triangles: %lld\n", ref_total);
+    printf("Average clustering coefficient: %.6f\n", average);
+    std::cout << "Timing Summary" << std::endl;
+    std::cout << timing.str();
+    printf("----------------------------------------------------------\n");
+    if (!check)
+        std::cout << "Triangle Counting is not Correct" << std::endl;
+
+    free(ref_triangles);
+    free(triangles);
+    free(coefficients);
+    free_graph(g);
+
+    return 0;
+}
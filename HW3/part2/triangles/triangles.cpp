@@ -0,0 +1,224 @@
+#include "triangles.h"
+
+#include <algorithm>
+#include <vector>
+#include <omp.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86_SIMD 1
+#endif
+
+#include "common/graph.h"
+#include "common/partition.h"
+
+// Parts of equal intersection work per thread, handed out dynamically
+#define PARTS_PER_THREAD 8
+
+Graph build_undirected(Graph g) {
+  int n = g->num_nodes;
+  // the merged list of v fits in the slots of its in- and out-edges
+  Vertex *merged = (Vertex *)malloc(sizeof(Vertex) * (2 * (size_t)g->num_edges + 1));
+  int *sizes = (int *)malloc(sizeof(int) * n);
+
+  #pragma omp parallel for schedule(dynamic, 1024)
+  for (int v = 0; v < n; v++) {
+    Vertex *list = merged + g->outgoing_starts[v] + g->incoming_starts[v];
+    int count = 0;
+    for (const Vertex *u = outgoing_begin(g, v); u != outgoing_end(g, v); u++)
+      list[count++] = *u;
+    for (const Vertex *u = incoming_begin(g, v); u != incoming_end(g, v); u++)
+      list[count++] = *u;
+    std::sort(list, list + count);
+    count = std::unique(list, list + count) - list;
+    sizes[v] = std::remove(list, list + count, v) - list;
+  }
+
+  int *starts = (int *)malloc(sizeof(int) * (n + 1));
+  parallel_prefix_sum<int>([&](int v) { return sizes[v]; }, n, starts);
+  Vertex *edges = (Vertex *)malloc(sizeof(Vertex) * std::max(starts[n], 1));
+  #pragma omp parallel for schedule(dynamic, 1024)
+  for (int v = 0; v < n; v++) {
+    memcpy(edges + starts[v], merged + g->outgoing_starts[v] + g->incoming_starts[v],
+           sizeof(Vertex) * sizes[v]);
+  }
+
+  free(merged);
+  free(sizes);
+  return graph_from_csr(n, starts[n], starts, edges);
+}
+
+// Write the common elements of two sorted lists to out and return how
+// many there are.
+typedef int (*intersect_fn)(const Vertex *a, int na, const Vertex *b, int nb, Vertex *out);
+
+static int intersect_scalar(const Vertex *a, int na, const Vertex *b, int nb, Vertex *out) {
+  int i = 0, j = 0, k = 0;
+  while (i < na && j < nb) {
+    if (a[i] < b[j]) {
+      i++;
+    } else if (a[i] > b[j]) {
+      j++;
+    } else {
+      out[k++] = a[i];
+      i++;
+      j++;
+    }
+  }
+  return k;
+}
+
+#ifdef HAVE_X86_SIMD
+// Block merge: compare 8 elements of a against all 8 rotations of 8
+// elements of b, then advance whichever block ends lower (or both).
+__attribute__((target("avx2")))
+static int intersect_avx2(const Vertex *a, int na, const Vertex *b, int nb, Vertex *out) {
+  const __m256i rotate = _mm256_set_epi32(0, 7, 6, 5, 4, 3, 2, 1);
+  int i = 0, j = 0, k = 0;
+  while (i + 8 <= na && j + 8 <= nb) {
+    __m256i va = _mm256_loadu_si256((const __m256i *)(a + i));
+    __m256i vb = _mm256_loadu_si256((const __m256i *)(b + j));
+    __m256i equal = _mm256_cmpeq_epi32(va, vb);
+    for (int r = 1; r < 8; r++) {
+      vb = _mm256_permutevar8x32_epi32(vb, rotate);
+      equal = _mm256_or_si256(equal, _mm256_cmpeq_epi32(va, vb));
+    }
+    int mask = _mm256_movemask_ps(_mm256_castsi256_ps(equal));
+    while (mask) {
+      out[k++] = a[i + __builtin_ctz(mask)];
+      mask &= mask - 1;
+    }
+    Vertex lastA = a[i + 7], lastB = b[j + 7];
+    if (lastA <= lastB)
+      i += 8;
+    if (lastB <= lastA)
+      j += 8;
+  }
+  return k + intersect_scalar(a + i, na - i, b + j, nb - j, out + k);
+}
+#endif
+
+static intersect_fn select_intersect(bool simd) {
+#ifdef HAVE_X86_SIMD
+  __builtin_cpu_init();
+  if (simd && __builtin_cpu_supports("avx2"))
+    return intersect_avx2;
+#endif
+  return intersect_scalar;
+}
+
+// u comes before v in the orientation: lower degree first, ties by id
+static inline bool precedes(Graph g, Vertex u, Vertex v) {
+  int du = outgoing_size(g, u), dv = outgoing_size(g, v);
+  return du < dv || (du == dv && u < v);
+}
+
+long long count_triangles(Graph g, long long *triangles, bool simd) {
+  int n = g->num_nodes;
+  intersect_fn intersect = select_intersect(simd);
+
+  // oriented CSR: the neighbors each vertex precedes, still sorted by id
+  int *sizes = (int *)malloc(sizeof(int) * n);
+  #pragma omp parallel for schedule(dynamic, 1024)
+  for (int u = 0; u < n; u++) {
+    int count = 0;
+    for (const Vertex *v = outgoing_begin(g, u); v != outgoing_end(g, u); v++)
+      count += precedes(g, u, *v);
+    sizes[u] = count;
+  }
+  int *starts = (int *)malloc(sizeof(int) * (n + 1));
+  parallel_prefix_sum<int>([&](int u) { return sizes[u]; }, n, starts);
+  Vertex *edges = (Vertex *)malloc(sizeof(Vertex) * std::max(starts[n], 1));
+  #pragma omp parallel for schedule(dynamic, 1024)
+  for (int u = 0; u < n; u++) {
+    Vertex *out = edges + starts[u];
+    for (const Vertex *v = outgoing_begin(g, u); v != outgoing_end(g, u); v++) {
+      if (precedes(g, u, *v))
+        *out++ = *v;
+    }
+    triangles[u] = 0;
+  }
+
+  // intersecting out(u) with out(v) for each oriented edge u->v costs
+  // about |out(u)| + |out(v)|
+  long long *work = (long long *)malloc(sizeof(long long) * (n + 1));
+  parallel_prefix_sum<long long>([&](int u) {
+    long long cost = 0;
+    for (int e = starts[u]; e < starts[u + 1]; e++)
+      cost += sizes[u] + sizes[edges[e]];
+    return cost;
+  }, n, work);
+  int parts = omp_get_max_threads() * PARTS_PER_THREAD;
+  std::vector<int> boundaries(parts + 1);
+  merge_path_partition([&](int u) { return work[u]; }, n, parts, boundaries.data());
+
+  long long total = 0;
+  #pragma omp parallel reduction(+:total)
+  {
+    // a common neighbor list is never longer than an oriented list
+    std::vector<Vertex> common;
+    #pragma omp for schedule(dynamic, 1)
+    for (int p = 0; p < parts; p++) {
+      for (int u = boundaries[p]; u < boundaries[p + 1]; u++) {
+        const Vertex *outU = edges + starts[u];
+        long long found = 0;
+        common.resize(std::max<size_t>(common.size(), sizes[u]));
+        for (int e = starts[u]; e < starts[u + 1]; e++) {
+          Vertex v = edges[e];
+          int k = intersect(outU, sizes[u], edges + starts[v], sizes[v], common.data());
+          for (int c = 0; c < k; c++)
+            __sync_fetch_and_add(&triangles[common[c]], 1);
+          if (k)
+            __sync_fetch_and_add(&triangles[v], k);
+          found += k;
+        }
+        if (found)
+          __sync_fetch_and_add(&triangles[u], found);
+        total += found;
+      }
+    }
+  }
+
+  free(sizes);
+  free(starts);
+  free(edges);
+  free(work);
+  return total;
+}
+
+long long count_triangles_naive(Graph g, long long *triangles) {
+  int n = g->num_nodes;
+  std::vector<Vertex> common;
+  for (int u = 0; u < n; u++)
+    triangles[u] = 0;
+
+  // each triangle u < v < w is found from its edge (u, v)
+  long long total = 0;
+  for (int u = 0; u < n; u++) {
+    common.resize(std::max<size_t>(common.size(), outgoing_size(g, u)));
+    for (const Vertex *v = outgoing_begin(g, u); v != outgoing_end(g, u); v++) {
+      if (*v <= u)
+        continue;
+      int k = intersect_scalar(outgoing_begin(g, u), outgoing_size(g, u),
+                               outgoing_begin(g, *v), outgoing_size(g, *v), common.data());
+      for (int c = 0; c < k; c++) {
+        if (common[c] > *v) {
+          triangles[u]++;
+          triangles[*v]++;
+          triangles[common[c]]++;
+          total++;
+        }
+      }
+    }
+  }
+  return total;
+}
+
+void clustering_coefficients(Graph g, const long long *triangles, double *coefficients) {
+  #pragma omp parallel for schedule(static)
+  for (int v = 0; v < g->num_nodes; v++) {
+    double degree = outgoing_size(g, v);
+    coefficients[v] = (degree < 2) ? 0.0 : 2.0 * triangles[v] / (degree * (degree - 1));
+  }
+}
@@ -0,0 +1,29 @@
+#ifndef __TRIANGLES_H__
+#define __TRIANGLES_H__
+
+#include "common/graph.h"
+
+// Triangle counting works on the undirected graph underlying g: edge
+// directions, duplicate edges and self loops are dropped, and every
+// outgoing list is sorted.  The result keeps both directions of each
+// edge, so outgoing_size is the undirected degree.
+Graph build_undirected(Graph g);
+
+// Triangles through each vertex of an undirected graph (as built
+// above); returns the total number of triangles.
+//
+// Edges are oriented from lower to higher degree, so every triangle is
+// found exactly once by intersecting the oriented lists of one of its
+// edges, and no list is longer than sqrt(2 * edges).  Vertices are
+// split into parts of equal intersection work.  simd intersects with
+// AVX2 when the CPU supports it.
+long long count_triangles(Graph g, long long* triangles, bool simd);
+
+// Serial reference: merges the full neighbor lists of every edge.
+long long count_triangles_naive(Graph g, long long* triangles);
+
+// Local clustering coefficient of each vertex: the fraction of its
+// neighbor pairs that are connected, 0 below degree 2.
+void clustering_coefficients(Graph g, const long long* triangles, double* coefficients);
+
+#endif